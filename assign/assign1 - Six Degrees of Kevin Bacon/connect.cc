@@ -0,0 +1,101 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <getopt.h>
+#include "imdb.h"
+#include "costars.h"
+using namespace std;
+
+static const int kWrongArgumentCount = 1;
+static const int kDatabaseNotFound = 2;
+static const int kActorNotFound = 3;
+static const int kDefaultRankingSize = 10;
+
+/**
+ * Function: printCostars
+ * ----------------------
+ * Lists the actor/actress's most frequent co-stars, with the number of
+ * movies each has appeared in alongside them.
+ */
+static void printCostars(const imdb& db, const string& player, int actorID, size_t count) {
+	vector<costar> ranking;
+	size_t total = rankCostars(db, actorID, count, ranking);
+	cout << player << " has appeared with " << total << " other actors";
+	if (ranking.empty()) {
+		cout << "." << endl;
+		return;
+	}
+	cout << "; the most frequent:" << endl;
+	for (size_t i = 0; i < ranking.size(); i++) {
+		cout << "    " << db.getActorName(ranking[i].actorID) << " (" << ranking[i].sharedMovies
+			<< (ranking[i].sharedMovies == 1 ? " movie" : " movies") << ")" << endl;
+	}
+}
+
+/**
+ * Function: printConnections
+ * --------------------------
+ * Lists every movie the two actors/actresses have appeared in together,
+ * followed by the best connected of the co-stars they have in common.
+ */
+static void printConnections(const imdb& db, const string& first, int firstID,
+		const string& second, int secondID, size_t count) {
+	vector<int> movieIDs;
+	findSharedMovies(db, firstID, secondID, movieIDs);
+	cout << first << " and " << second << " have appeared together in " << movieIDs.size()
+		<< (movieIDs.size() == 1 ? " movie" : " movies") << (movieIDs.empty() ? "." : ":") << endl;
+	for (size_t i = 0; i < movieIDs.size(); i++) {
+		film movie = db.getMovie(movieIDs[i]);
+		cout << "    " << movie.title << " (" << movie.year << ")" << endl;
+	}
+
+	vector<commoncostar> ranking;
+	size_t total = findCommonCostars(db, firstID, secondID, count, ranking);
+	cout << "They have " << total << " co-stars in common" << (ranking.empty() ? "." : "; the best connected:") << endl;
+	for (size_t i = 0; i < ranking.size(); i++) {
+		cout << "    " << db.getActorName(ranking[i].actorID) << " (" << ranking[i].firstShared << " with "
+			<< first << ", " << ranking[i].secondShared << " with " << second << ")" << endl;
+	}
+}
+
+static void printUsage(const char *progname) {
+	cerr << "Usage: " << progname << " [-k count] <actor> [<other-actor>]" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	int count = kDefaultRankingSize;
+	int opt;
+	while ((opt = getopt(argc, argv, "k:")) != -1) {
+		switch (opt) {
+		case 'k':
+			count = atoi(optarg);
+			break;
+		default:
+			printUsage(argv[0]);
+			return kWrongArgumentCount;
+		}
+	}
+	if (argc - optind < 1 || argc - optind > 2 || count < 0) {
+		printUsage(argv[0]);
+		return kWrongArgumentCount;
+	}
+
+	imdb db(kIMDBDataDirectory);
+	if (!db.good()) {
+		cerr << db.getError() << "!  Aborting..." << endl;
+		return kDatabaseNotFound;
+	}
+	vector<int> actorIDs;
+	for (int i = optind; i < argc; i++) {
+		actorIDs.push_back(db.getActorID(argv[i]));
+		if (actorIDs.back() == imdb::kNoID) {
+			cerr << argv[i] << " doesn't appear to be in our database." << endl;
+			return kActorNotFound;
+		}
+	}
+
+	if (actorIDs.size() == 1) printCostars(db, argv[optind], actorIDs[0], count);
+	else printConnections(db, argv[optind], actorIDs[0], argv[optind + 1], actorIDs[1], count);
+	return 0;
+}
@@ -0,0 +1,129 @@
+#include "costars.h"
+#include <algorithm>
+using namespace std;
+
+/**
+ * When one list is at least this many times longer than the other, each
+ * ID of the shorter is binary searched for in the longer instead.
+ */
+static const size_t kGallopRatio = 32;
+
+void intersectSorted(const vector<int>& first, const vector<int>& second, vector<int>& common) {
+	const vector<int>& shorter = first.size() <= second.size() ? first : second;
+	const vector<int>& longer = first.size() <= second.size() ? second : first;
+	common.resize(shorter.size());
+	size_t found = 0;
+	if(shorter.size() * kGallopRatio <= longer.size()) {
+		vector<int>::const_iterator from = longer.begin();
+		for(size_t i = 0; i < shorter.size(); i++) {
+			from = lower_bound(from, longer.end(), shorter[i]);
+			if(from == longer.end()) break;
+			if(*from == shorter[i]) common[found++] = shorter[i];
+		}
+	} else {
+		// every step writes the smaller ID and keeps it only if both lists hold it
+		const int *a = shorter.data(), *b = longer.data();
+		size_t i = 0, j = 0;
+		while(i < shorter.size() && j < longer.size()) {
+			int x = a[i], y = b[j];
+			common[found] = x;
+			found += x == y;
+			i += x <= y;
+			j += y <= x;
+		}
+	}
+	common.resize(found);
+}
+
+void findSharedMovies(const imdb& db, int actorID, int otherID, vector<int>& movieIDs) {
+	idspan firstCredits = db.getCreditIDs(actorID), secondCredits = db.getCreditIDs(otherID);
+	vector<int> first(firstCredits.begin(), firstCredits.end());
+	vector<int> second(secondCredits.begin(), secondCredits.end());
+	sort(first.begin(), first.end());
+	sort(second.begin(), second.end());
+	intersectSorted(first, second, movieIDs);
+}
+
+/**
+ * Counts, for everyone the actor has appeared with, the number of movies
+ * they've appeared in together, leaving the counts in the tally along with
+ * the IDs of everyone counted.
+ */
+static void countCostars(const imdb& db, int actorID, costarscratch::tally& tally) {
+	if(tally.counts.size() != (size_t) db.getActorCount()) {
+		tally.counts.assign(db.getActorCount(), 0);
+		tally.touched.clear();
+	}
+	for(size_t i = 0; i < tally.touched.size(); i++) tally.counts[tally.touched[i]] = 0;
+	tally.touched.clear();
+	idspan credits = db.getCreditIDs(actorID);
+	for(idspan::iterator i = credits.begin(); i != credits.end(); ++i) {
+		idspan cast = db.getCastIDs(*i);
+		for(idspan::iterator j = cast.begin(); j != cast.end(); ++j) {
+			int costar_id = *j;
+			if(costar_id == actorID) continue;
+			if(tally.counts[costar_id]++ == 0) tally.touched.push_back(costar_id);
+		}
+	}
+}
+
+size_t rankCostars(const imdb& db, int actorID, size_t count, vector<costar>& ranking) {
+	costarscratch scratch;
+	return rankCostars(db, actorID, count, ranking, scratch);
+}
+
+size_t rankCostars(const imdb& db, int actorID, size_t count, vector<costar>& ranking,
+		costarscratch& scratch) {
+	costarscratch::tally& tally = scratch.first;
+	countCostars(db, actorID, tally);
+	ranking.resize(tally.touched.size());
+	for(size_t i = 0; i < tally.touched.size(); i++) {
+		ranking[i].actorID = tally.touched[i];
+		ranking[i].sharedMovies = tally.counts[tally.touched[i]];
+	}
+	if(count == 0 || count > ranking.size()) count = ranking.size();
+	partial_sort(ranking.begin(), ranking.begin() + count, ranking.end(), [](const costar& a, const costar& b) {
+		return a.sharedMovies != b.sharedMovies ? a.sharedMovies > b.sharedMovies : a.actorID < b.actorID;
+	});
+	size_t total = ranking.size();
+	ranking.resize(count);
+	return total;
+}
+
+size_t findCommonCostars(const imdb& db, int actorID, int otherID, size_t count,
+		vector<commoncostar>& ranking) {
+	costarscratch scratch;
+	return findCommonCostars(db, actorID, otherID, count, ranking, scratch);
+}
+
+size_t findCommonCostars(const imdb& db, int actorID, int otherID, size_t count,
+		vector<commoncostar>& ranking, costarscratch& scratch) {
+	countCostars(db, actorID, scratch.first);
+	countCostars(db, otherID, scratch.second);
+
+	// walk the shorter list of co-stars, keeping those the other side counted too
+	bool firstShorter = scratch.first.touched.size() <= scratch.second.touched.size();
+	const vector<int>& shorter = firstShorter ? scratch.first.touched : scratch.second.touched;
+	const vector<int>& otherCounts = firstShorter ? scratch.second.counts : scratch.first.counts;
+	ranking.clear();
+	for(size_t i = 0; i < shorter.size(); i++) {
+		int costar_id = shorter[i];
+		if(otherCounts[costar_id] == 0 || costar_id == actorID || costar_id == otherID) continue;
+		commoncostar c;
+		c.actorID = costar_id;
+		c.firstShared = scratch.first.counts[costar_id];
+		c.secondShared = scratch.second.counts[costar_id];
+		ranking.push_back(c);
+	}
+	if(count == 0 || count > ranking.size()) count = ranking.size();
+	partial_sort(ranking.begin(), ranking.begin() + count, ranking.end(),
+		[](const commoncostar& a, const commoncostar& b) {
+		int weakerA = min(a.firstShared, a.secondShared), weakerB = min(b.firstShared, b.secondShared);
+		if(weakerA != weakerB) return weakerA > weakerB;
+		int totalA = a.firstShared + a.secondShared, totalB = b.firstShared + b.secondShared;
+		return totalA != totalB ? totalA > totalB : a.actorID < b.actorID;
+	});
+	size_t total = ranking.size();
+	ranking.resize(count);
+	return total;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "imdb.h"
+#include <cstddef>
+#include <vector>
+
+/**
+ * Convenience structs: costar
+ *                      commoncostar
+ * ---------------------------------
+ * The entries of the rankings below.  A costar is an actor/actress along
+ * with the number of movies they've appeared in with the actor/actress
+ * queried.  A commoncostar is someone who has appeared with both of the
+ * actors/actresses queried, along with the number of movies they've
+ * appeared in with each.
+ */
+struct costar {
+  int actorID;
+  int sharedMovies;
+};
+
+struct commoncostar {
+  int actorID;
+  int firstShared;
+  int secondShared;
+};
+
+/**
+ * Class: costarscratch
+ * --------------------
+ * Working memory for the co-star queries: for each of the (at most two)
+ * actors/actresses queried, a count per actor sized to the database and the
+ * list of actors whose counts are in use.  As with searchscratch, a
+ * long-running client keeps one per thread so that a query only ever clears
+ * the counts the previous one touched.  A costarscratch may be moved on to
+ * a different imdb; the counts are resized whenever the actor count changes.
+ */
+class costarscratch {
+ public:
+  costarscratch() {}
+
+  struct tally {
+    std::vector<int> counts;
+    std::vector<int> touched;
+  };
+
+  tally first;
+  tally second;
+
+ private:
+  costarscratch(const costarscratch& original) = delete;
+  costarscratch& operator=(const costarscratch& rhs) = delete;
+};
+
+/**
+ * Function: intersectSorted
+ * -------------------------
+ * Replaces the contents of common with the IDs appearing in both first and
+ * second, each of which must be sorted.  The merge advances through both
+ * with comparisons rather than branches, so its cost doesn't depend on how
+ * the IDs interleave, and it switches to binary searching the longer list
+ * when one is much longer than the other.
+ */
+void intersectSorted(const std::vector<int>& first, const std::vector<int>& second,
+                     std::vector<int>& common);
+
+/**
+ * Function: findSharedMovies
+ * --------------------------
+ * Replaces the contents of movieIDs with the IDs, in order, of every movie
+ * both actors/actresses appeared in.
+ */
+void findSharedMovies(const imdb& db, int actorID, int otherID, std::vector<int>& movieIDs);
+
+/**
+ * Function: rankCostars
+ * ---------------------
+ * Ranks everyone the actor/actress has appeared with by the number of movies
+ * they've appeared in together, most first and ties broken by name, keeping
+ * the top count of them (or all of them, if count is 0).
+ *
+ * @param db the imdb to be consulted.
+ * @param actorID the ID of the actor/actress whose co-stars are ranked.
+ * @param count the number of co-stars to keep, or 0 to keep them all.
+ * @param ranking updated to hold the top co-stars.
+ * @param scratch working memory to reuse; the first form allocates its own.
+ * @return the total number of co-stars, however many were kept.
+ */
+size_t rankCostars(const imdb& db, int actorID, size_t count, std::vector<costar>& ranking);
+size_t rankCostars(const imdb& db, int actorID, size_t count, std::vector<costar>& ranking,
+                   costarscratch& scratch);
+
+/**
+ * Function: findCommonCostars
+ * ---------------------------
+ * Finds everyone who has appeared with both actors/actresses (other than
+ * the two themselves), which is to say everyone on a path of length two
+ * between them.  Each side's co-stars are counted into its own tally, and
+ * the shorter list of co-stars is checked against the other side's counts,
+ * so nothing needs sorting.  The result is ranked by the weaker of the
+ * two links, then by their total and then by name, keeping the top count
+ * (or all of them, if count is 0).
+ *
+ * @return the total number of co-stars in common, however many were kept.
+ */
+size_t findCommonCostars(const imdb& db, int actorID, int otherID, size_t count,
+                         std::vector<commoncostar>& ranking);
+size_t findCommonCostars(const imdb& db, int actorID, int otherID, size_t count,
+                         std::vector<commoncostar>& ranking, costarscratch& scratch);
@@ -0,0 +1,410 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "imdb.h"
+#include "search-engine.h"
+using namespace std;
+
+static const int kWrongArgumentCount = 1;
+static const int kDatabaseNotFound = 2;
+static const int kBaselineNotFound = 3;
+static const int kRunFailed = 4;
+static const int kRegression = 5;
+static const int kDefaultOperationCount = 10000;
+static const int kDefaultRepetitions = 5;
+static const int kDefaultThreshold = 10;
+static const size_t kHotCount = 100;
+static const size_t kSearchCount = 4;
+
+/**
+ * Convenience struct: workload
+ * ----------------------------
+ * The actors/actresses and movies a benchmark runs over, by ID and by name.
+ * The hot workload holds the actors with the most credits and the movies
+ * with the largest casts; the random one holds uniformly chosen ones.
+ */
+struct workload {
+	string name;
+	vector<int> actorIDs;
+	vector<string> players;
+	vector<int> movieIDs;
+	vector<film> movies;
+};
+
+/**
+ * Convenience struct: benchmark
+ * -----------------------------
+ * A named operation, run once for each of the first count entries of its
+ * workload.  Each run returns a value derived from what it decoded, which
+ * is summed so that nothing can be optimized away and so that every pass
+ * can be checked against the first.
+ */
+struct benchmark {
+	string name;
+	size_t count;
+	function<size_t(const imdb& db, size_t i)> run;
+};
+
+/**
+ * Convenience struct: measurement
+ * -------------------------------
+ * Everything recorded about a single benchmark: the cost of an operation
+ * during the first pass over the workload, right after the imdb is opened,
+ * and during the passes that follow, along with the page faults the first
+ * pass took.
+ */
+struct measurement {
+	double coldNanos;
+	double warmNanos;
+	double minNanos;
+	long majorFaults;
+	long minorFaults;
+	bool consistent;
+};
+
+/**
+ * Function: chooseWorkloads
+ * -------------------------
+ * Builds the hot and random workloads, the latter holding count entries
+ * chosen with a generator seeded with seed.
+ */
+static void chooseWorkloads(const imdb& db, size_t count, unsigned seed, workload& hot, workload& random) {
+	vector<int> actorIDs(db.getActorCount()), movieIDs(db.getMovieCount());
+	for (size_t i = 0; i < actorIDs.size(); i++) actorIDs[i] = i;
+	for (size_t i = 0; i < movieIDs.size(); i++) movieIDs[i] = i;
+	size_t hotActors = min(kHotCount, actorIDs.size()), hotMovies = min(kHotCount, movieIDs.size());
+	partial_sort(actorIDs.begin(), actorIDs.begin() + hotActors, actorIDs.end(), [&db](int a, int b) {
+		size_t creditsA = db.getCreditIDs(a).size(), creditsB = db.getCreditIDs(b).size();
+		return creditsA != creditsB ? creditsA > creditsB : a < b;
+	});
+	partial_sort(movieIDs.begin(), movieIDs.begin() + hotMovies, movieIDs.end(), [&db](int a, int b) {
+		size_t castA = db.getCastIDs(a).size(), castB = db.getCastIDs(b).size();
+		return castA != castB ? castA > castB : a < b;
+	});
+	hot.name = "hot";
+	hot.actorIDs.assign(actorIDs.begin(), actorIDs.begin() + hotActors);
+	hot.movieIDs.assign(movieIDs.begin(), movieIDs.begin() + hotMovies);
+
+	mt19937 generator(seed);
+	uniform_int_distribution<int> pickActor(0, db.getActorCount() - 1);
+	uniform_int_distribution<int> pickMovie(0, db.getMovieCount() - 1);
+	random.name = "random";
+	for (size_t i = 0; i < count; i++) {
+		random.actorIDs.push_back(pickActor(generator));
+		random.movieIDs.push_back(pickMovie(generator));
+	}
+
+	workload *const workloads[] = {&hot, &random};
+	for (workload *w : workloads) {
+		for (int actorID : w->actorIDs) w->players.push_back(db.getActorName(actorID));
+		for (int movieID : w->movieIDs) w->movies.push_back(db.getMovie(movieID));
+	}
+}
+
+/**
+ * Function: addBenchmarks
+ * -----------------------
+ * Appends the benchmarks run over the specified workload.  The lookups
+ * and the decoders each run once per entry; the full searches, which cost
+ * as much as thousands of decodes, only run from the first few actors.
+ */
+static void addBenchmarks(const workload& w, vector<benchmark>& benchmarks) {
+	const workload *load = &w;
+	size_t actors = w.actorIDs.size(), movies = w.movieIDs.size();
+	benchmarks.push_back(benchmark{"actor-id/" + w.name, actors, [load](const imdb& db, size_t i) {
+		return (size_t) db.getActorID(load->players[i]);
+	}});
+	benchmarks.push_back(benchmark{"movie-id/" + w.name, movies, [load](const imdb& db, size_t i) {
+		return (size_t) db.getMovieID(load->movies[i]);
+	}});
+	benchmarks.push_back(benchmark{"actor-name/" + w.name, actors, [load](const imdb& db, size_t i) {
+		return string(db.getActorName(load->actorIDs[i])).size();
+	}});
+	benchmarks.push_back(benchmark{"movie/" + w.name, movies, [load](const imdb& db, size_t i) {
+		film movie = db.getMovie(load->movieIDs[i]);
+		return movie.title.size() + movie.year;
+	}});
+	benchmarks.push_back(benchmark{"credits/" + w.name, actors, [load](const imdb& db, size_t i) {
+		vector<film> films;
+		db.getCredits(load->players[i], films);
+		size_t sum = 0;
+		for (const film& movie : films) sum += movie.title.size() + movie.year;
+		return sum;
+	}});
+	benchmarks.push_back(benchmark{"cast/" + w.name, movies, [load](const imdb& db, size_t i) {
+		vector<string> players;
+		db.getCast(load->movies[i], players);
+		size_t sum = 0;
+		for (const string& player : players) sum += player.size();
+		return sum;
+	}});
+	benchmarks.push_back(benchmark{"each-credit/" + w.name, actors, [load](const imdb& db, size_t i) {
+		size_t sum = 0;
+		db.forEachCredit(load->actorIDs[i], [&sum](const char *title, int year) { sum += (unsigned char) title[0] + year; });
+		return sum;
+	}});
+	benchmarks.push_back(benchmark{"each-cast/" + w.name, movies, [load](const imdb& db, size_t i) {
+		size_t sum = 0;
+		db.forEachCast(load->movieIDs[i], [&sum](const char *name) { sum += (unsigned char) name[0]; });
+		return sum;
+	}});
+	benchmarks.push_back(benchmark{"credit-ids/" + w.name, actors, [load](const imdb& db, size_t i) {
+		idspan credits = db.getCreditIDs(load->actorIDs[i]);
+		size_t sum = 0;
+		for (idspan::iterator j = credits.begin(); j != credits.end(); ++j) sum += *j;
+		return sum;
+	}});
+	benchmarks.push_back(benchmark{"cast-ids/" + w.name, movies, [load](const imdb& db, size_t i) {
+		idspan cast = db.getCastIDs(load->movieIDs[i]);
+		size_t sum = 0;
+		for (idspan::iterator j = cast.begin(); j != cast.end(); ++j) sum += *j;
+		return sum;
+	}});
+	benchmarks.push_back(benchmark{"bfs/" + w.name, min(kSearchCount, actors), [load](const imdb& db, size_t i) {
+		vector<int> distances;
+		computeDistances(db, load->actorIDs[i], distances);
+		size_t sum = 0;
+		for (int distance : distances) sum += distance + 1;
+		return sum;
+	}});
+}
+
+/**
+ * Function: dropCache
+ * -------------------
+ * Asks the kernel to evict the data files from the page cache, as in
+ * map-bench, so that the first pass of the next benchmark starts cold.
+ * Only clean pages that nobody has mapped can go, which is why the
+ * benchmark closes its own imdb before measuring anything.
+ */
+static void dropCache(const string& directory) {
+	const char *const fileNames[] = {
+		imdb::kActorFileName, imdb::kMovieFileName, imdb::kIndexFileName, imdb::kLandmarkFileName
+	};
+	for (size_t i = 0; i < sizeof(fileNames) / sizeof(fileNames[0]); i++) {
+		int fd = open((directory + "/" + fileNames[i]).c_str(), O_RDONLY);
+		if (fd == -1) continue;
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+}
+
+/**
+ * Function: runPass
+ * -----------------
+ * Runs the benchmark once over its workload, returning the average cost of
+ * an operation in nanoseconds and leaving the sum of what the runs returned
+ * in checksum.
+ */
+static double runPass(const imdb& db, const benchmark& b, size_t& checksum) {
+	checksum = 0;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (size_t i = 0; i < b.count; i++) checksum += b.run(db, i);
+	chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+	return elapsed.count() / b.count;
+}
+
+/**
+ * Function: measure
+ * -----------------
+ * Opens the imdb in a forked child, so that every benchmark starts with
+ * a fresh mapping and heap, runs the cold pass followed by repetitions warm
+ * ones, and reports back over a pipe.  The warm cost is the median of the
+ * warm passes.
+ */
+static bool measure(const string& directory, const benchmark& b, int repetitions, measurement& m) {
+	int fds[2];
+	if (pipe(fds) == -1) return false;
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(fds[0]);
+		imdb db(directory);
+		if (!db.good()) _exit(1);
+		measurement result;
+		struct rusage before, after;
+		size_t expected, checksum;
+		getrusage(RUSAGE_SELF, &before);
+		result.coldNanos = runPass(db, b, expected);
+		getrusage(RUSAGE_SELF, &after);
+		result.majorFaults = after.ru_majflt - before.ru_majflt;
+		result.minorFaults = after.ru_minflt - before.ru_minflt;
+		result.consistent = true;
+		vector<double> passes(repetitions);
+		for (int i = 0; i < repetitions; i++) {
+			passes[i] = runPass(db, b, checksum);
+			if (checksum != expected) result.consistent = false;
+		}
+		sort(passes.begin(), passes.end());
+		result.warmNanos = passes[passes.size() / 2];
+		result.minNanos = passes[0];
+		_exit(write(fds[1], &result, sizeof(result)) == sizeof(result) ? 0 : 1);
+	}
+	close(fds[1]);
+	bool success = pid != -1 && read(fds[0], &m, sizeof(m)) == sizeof(m);
+	close(fds[0]);
+	if (pid != -1) waitpid(pid, NULL, 0);
+	return success;
+}
+
+/**
+ * Function: readBaseline
+ * ----------------------
+ * Reads the warm cost of each benchmark from the output of an earlier run
+ * with -f tsv.  The header and any lines that don't parse are skipped.
+ */
+static bool readBaseline(const string& fileName, map<string, double>& baseline) {
+	ifstream infile(fileName.c_str());
+	if (!infile) return false;
+	string line;
+	while (getline(infile, line)) {
+		istringstream fields(line);
+		string name;
+		size_t ops;
+		int repetitions;
+		double coldNanos, warmNanos;
+		if (fields >> name >> ops >> repetitions >> coldNanos >> warmNanos) baseline[name] = warmNanos;
+	}
+	return true;
+}
+
+/**
+ * Function: printMeasurement
+ * --------------------------
+ * Prints one benchmark's results as a row of a table, as tab-separated
+ * values (matching the header printed first) or as a JSON object on a line
+ * of its own.
+ */
+static void printMeasurement(const string& format, const benchmark& b, int repetitions, const measurement& m) {
+	if (format == "json") {
+		cout << "{\"name\": \"" << b.name << "\", \"ops\": " << b.count << ", \"reps\": " << repetitions
+			<< fixed << setprecision(1) << ", \"cold_ns\": " << m.coldNanos << ", \"warm_ns\": " << m.warmNanos
+			<< ", \"min_ns\": " << m.minNanos << ", \"major_faults\": " << m.majorFaults
+			<< ", \"minor_faults\": " << m.minorFaults << "}" << endl;
+	} else if (format == "tsv") {
+		cout << b.name << '\t' << b.count << '\t' << repetitions << fixed << setprecision(1) << '\t' << m.coldNanos
+			<< '\t' << m.warmNanos << '\t' << m.minNanos << '\t' << m.majorFaults << '\t' << m.minorFaults << endl;
+	} else {
+		cout << left << setw(20) << b.name << right << setw(8) << b.count << fixed << setprecision(1)
+			<< setw(14) << m.coldNanos << setw(14) << m.warmNanos << setw(14) << m.minNanos
+			<< setw(10) << m.majorFaults << setw(10) << m.minorFaults << endl;
+	}
+}
+
+static void printHeader(const string& format) {
+	if (format == "tsv") {
+		cout << "name\tops\treps\tcold_ns\twarm_ns\tmin_ns\tmajor_faults\tminor_faults" << endl;
+	} else if (format == "table") {
+		cout << left << setw(20) << "benchmark" << right << setw(8) << "ops" << setw(14) << "cold ns/op"
+			<< setw(14) << "warm ns/op" << setw(14) << "min ns/op" << setw(10) << "major" << setw(10) << "minor" << endl;
+	}
+}
+
+static void printUsage(const char *progname) {
+	cerr << "Usage: " << progname << " [-d data-directory] [-n operations] [-r repetitions] [-s seed]" << endl
+		<< "       [-b benchmark-prefix] [-f table|tsv|json] [-c baseline-file] [-x percent]" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	string directory = kIMDBDataDirectory;
+	int numOperations = kDefaultOperationCount;
+	int repetitions = kDefaultRepetitions;
+	unsigned seed = 110;
+	string prefix;
+	string format = "table";
+	string baselineFile;
+	int threshold = kDefaultThreshold;
+	int opt;
+	while ((opt = getopt(argc, argv, "d:n:r:s:b:f:c:x:")) != -1) {
+		switch (opt) {
+		case 'd':
+			directory = optarg;
+			break;
+		case 'n':
+			numOperations = atoi(optarg);
+			break;
+		case 'r':
+			repetitions = atoi(optarg);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			prefix = optarg;
+			break;
+		case 'f':
+			format = optarg;
+			break;
+		case 'c':
+			baselineFile = optarg;
+			break;
+		case 'x':
+			threshold = atoi(optarg);
+			break;
+		default:
+			printUsage(argv[0]);
+			return kWrongArgumentCount;
+		}
+	}
+	if (optind != argc || numOperations < 1 || repetitions < 1 || threshold < 0 ||
+		(format != "table" && format != "tsv" && format != "json")) {
+		printUsage(argv[0]);
+		return kWrongArgumentCount;
+	}
+
+	map<string, double> baseline;
+	if (!baselineFile.empty() && !readBaseline(baselineFile, baseline)) {
+		cerr << "Baseline file \"" << baselineFile << "\" not found!  Aborting..." << endl;
+		return kBaselineNotFound;
+	}
+
+	workload hot, random;
+	{
+		imdb db(directory);
+		if (!db.good()) {
+			cerr << db.getError() << "!  Aborting..." << endl;
+			return kDatabaseNotFound;
+		}
+		chooseWorkloads(db, numOperations, seed, hot, random);
+	}
+	vector<benchmark> benchmarks;
+	addBenchmarks(hot, benchmarks);
+	addBenchmarks(random, benchmarks);
+
+	printHeader(format);
+	int regressions = 0;
+	for (const benchmark& b : benchmarks) {
+		if (b.name.compare(0, prefix.size(), prefix) != 0 || b.count == 0) continue;
+		dropCache(directory);
+		measurement m;
+		if (!measure(directory, b, repetitions, m)) {
+			cerr << "Failed to run " << b.name << "!  Aborting..." << endl;
+			return kRunFailed;
+		}
+		if (!m.consistent) {
+			cerr << b.name << " decoded something different on a later pass!  Aborting..." << endl;
+			return kRunFailed;
+		}
+		printMeasurement(format, b, repetitions, m);
+		map<string, double>::const_iterator found = baseline.find(b.name);
+		if (found != baseline.end() && m.warmNanos > found->second * (100 + threshold) / 100) {
+			cerr << b.name << " regressed: " << fixed << setprecision(1) << m.warmNanos << " ns/op against "
+				<< found->second << " ns/op in the baseline" << endl;
+			regressions++;
+		}
+	}
+	return regressions > 0 ? kRegression : 0;
+}
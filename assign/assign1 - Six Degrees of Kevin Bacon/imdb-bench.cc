@@ -0,0 +1,157 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <getopt.h>
+#include "imdb.h"
+using namespace std;
+
+static const int kWrongArgumentCount = 1;
+static const int kDatabaseNotFound = 2;
+static const int kLookupMismatch = 3;
+static const int kDefaultLookupCount = 1000000;
+static const int kMissPercentage = 10;
+
+/**
+ * Function: lowerBoundID
+ * ----------------------
+ * std::lower_bound over the range of IDs [first, last), comparing
+ * each ID probed against the value sought.
+ */
+template <typename T, typename Less>
+static int lowerBoundID(int first, int last, const T& value, Less less) {
+	while (first < last) {
+		int mid = first + (last - first) / 2;
+		if (less(mid, value)) first = mid + 1;
+		else last = mid;
+	}
+	return first;
+}
+
+/**
+ * Function: copyingActorID / copyingMovieID
+ * -----------------------------------------
+ * Name lookups the way imdb used to do them: a binary search in which every
+ * comparison copies the record's name (or the whole film) out of the mapped
+ * file.  Kept here as the baseline the real lookups are measured against.
+ */
+static int copyingActorID(const imdb& db, const string& player) {
+	int count = db.getActorCount();
+	int pos = lowerBoundID(0, count, player, [&db](int id, const string& name) {
+		return string(db.getActorName(id)) < name;
+	});
+	return pos != count && string(db.getActorName(pos)) == player ? pos : imdb::kNoID;
+}
+
+static int copyingMovieID(const imdb& db, const film& movie) {
+	int count = db.getMovieCount();
+	int pos = lowerBoundID(0, count, movie, [&db](int id, const film& fi) {
+		return db.getMovie(id) < fi;
+	});
+	return pos != count && db.getMovie(pos) == movie ? pos : imdb::kNoID;
+}
+
+/**
+ * Function: timeLookups
+ * ---------------------
+ * Runs lookup on every query, recording the IDs found, and prints the
+ * average cost of a lookup.
+ */
+template <typename Query>
+static void timeLookups(const string& label, const vector<Query>& queries,
+		function<int(const Query&)> lookup, vector<int>& ids) {
+	ids.resize(queries.size());
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	for (size_t i = 0; i < queries.size(); i++) ids[i] = lookup(queries[i]);
+	chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+	cout << left << setw(28) << label << right << setw(12) << fixed << setprecision(1)
+		<< elapsed.count() / queries.size() << " ns/lookup" << endl;
+}
+
+static void printUsage(const char *progname) {
+	cerr << "Usage: " << progname << " [-d data-directory] [-n lookups] [-s seed]" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	string directory = kIMDBDataDirectory;
+	int numLookups = kDefaultLookupCount;
+	unsigned seed = 110;
+	int opt;
+	while ((opt = getopt(argc, argv, "d:n:s:")) != -1) {
+		switch (opt) {
+		case 'd':
+			directory = optarg;
+			break;
+		case 'n':
+			numLookups = atoi(optarg);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			printUsage(argv[0]);
+			return kWrongArgumentCount;
+		}
+	}
+	if (optind != argc || numLookups < 1) {
+		printUsage(argv[0]);
+		return kWrongArgumentCount;
+	}
+
+	imdb db(directory);
+	if (!db.good()) {
+		cerr << db.getError() << "!  Aborting..." << endl;
+		return kDatabaseNotFound;
+	}
+
+	// random names from the database, with a few that aren't in it
+	mt19937 generator(seed);
+	uniform_int_distribution<int> percent(0, 99);
+	uniform_int_distribution<int> pickActor(0, db.getActorCount() - 1);
+	uniform_int_distribution<int> pickMovie(0, db.getMovieCount() - 1);
+	vector<string> players(numLookups);
+	vector<film> movies(numLookups);
+	for (int i = 0; i < numLookups; i++) {
+		players[i] = db.getActorName(pickActor(generator));
+		movies[i] = db.getMovie(pickMovie(generator));
+		if (percent(generator) < kMissPercentage) {
+			players[i] += " (missing)";
+			movies[i].year += 200;
+		}
+	}
+
+	cout << numLookups << " actor and " << numLookups << " movie lookups, "
+		<< kMissPercentage << "% misses" << endl << endl;
+	vector<int> copyingActors, inPlaceActors, hashedActors;
+	vector<int> copyingMovies, inPlaceMovies, hashedMovies;
+	timeLookups<string>("actors, copying compare", players,
+		[&db](const string& player) { return copyingActorID(db, player); }, copyingActors);
+	timeLookups<string>("actors, in-place compare", players,
+		[&db](const string& player) { return db.getActorID(player); }, inPlaceActors);
+	timeLookups<film>("movies, copying compare", movies,
+		[&db](const film& movie) { return copyingMovieID(db, movie); }, copyingMovies);
+	timeLookups<film>("movies, in-place compare", movies,
+		[&db](const film& movie) { return db.getMovieID(movie); }, inPlaceMovies);
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	db.buildNameIndex();
+	chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+	cout << left << setw(28) << "building the name index" << right << setw(12) << fixed
+		<< setprecision(1) << elapsed.count() << " ms" << endl;
+	timeLookups<string>("actors, name index", players,
+		[&db](const string& player) { return db.getActorID(player); }, hashedActors);
+	timeLookups<film>("movies, name index", movies,
+		[&db](const film& movie) { return db.getMovieID(movie); }, hashedMovies);
+
+	if (copyingActors != inPlaceActors || copyingActors != hashedActors ||
+		copyingMovies != inPlaceMovies || copyingMovies != hashedMovies) {
+		cerr << "The lookups disagreed on some IDs!" << endl;
+		return kLookupMismatch;
+	}
+	return 0;
+}
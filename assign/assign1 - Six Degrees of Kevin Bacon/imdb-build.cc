@@ -0,0 +1,568 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <queue>
+#include <tuple>
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <getopt.h>
+#include <unistd.h>
+#include "imdb.h"
+using namespace std;
+
+static const int kWrongArgumentCount = 1;
+static const int kCreditsNotFound = 2;
+static const int kMalformedCredits = 3;
+static const int kDatabaseNotWritten = 4;
+static const size_t kDefaultMemoryMB = 256;
+static const size_t kMaxMergeWidth = 128;
+static const int kFirstYear = 1900;
+static const int kLastYear = 1900 + 255;  // years are stored as a byte past 1900
+static const int kMaxEntries = SHRT_MAX;  // credit and cast counts are stored as shorts
+
+/**
+ * Function: openScratchFile
+ * -------------------------
+ * Creates a read-write file in the scratch directory and unlinks it right
+ * away, so that it disappears once closed, however the program exits.
+ * Returns NULL if the file couldn't be created.
+ */
+static FILE *openScratchFile(const string& directory) {
+	string pattern = directory + "/imdb-build.XXXXXX";
+	vector<char> name(pattern.begin(), pattern.end());
+	name.push_back('\0');
+	int fd = mkstemp(name.data());
+	if (fd == -1) return NULL;
+	unlink(name.data());
+	FILE *file = fdopen(fd, "w+b");
+	if (file == NULL) close(fd);
+	return file;
+}
+
+/**
+ * Functions: writeValue / readValue
+ *            writeString / readString
+ * -----------------------------------
+ * The scratch files' encoding: values are written as their raw bytes, and
+ * strings as an int length followed by their characters.
+ */
+template <typename T>
+static void writeValue(FILE *file, const T& value) {
+	fwrite(&value, sizeof(value), 1, file);
+}
+
+template <typename T>
+static bool readValue(FILE *file, T& value) {
+	return fread(&value, sizeof(value), 1, file) == 1;
+}
+
+static void writeString(FILE *file, const string& s) {
+	writeValue<int>(file, s.size());
+	fwrite(s.data(), 1, s.size(), file);
+}
+
+static bool readString(FILE *file, string& s) {
+	int length;
+	if (!readValue(file, length)) return false;
+	s.resize(length);
+	return length == 0 || fread(&s[0], 1, length, file) == (size_t) length;
+}
+
+/**
+ * Convenience structs: credit, casting and billing
+ * ------------------------------------------------
+ * The records passed from one stage of the build to the next.  A credit
+ * is a line of the input: an actor/actress, a movie and the line's number,
+ * which is what keeps each actor/actress's credits in input order.  A
+ * casting is a credit once the actor/actress has an ID, ordered by movie,
+ * and a billing is a credit once both sides have IDs, ordered by actor/
+ * actress.  Each knows how to write itself to and read itself back from a
+ * scratch file, and roughly how much memory it takes up.
+ */
+struct credit {
+	string player;
+	string title;
+	int year;
+	long line;
+
+	bool operator<(const credit& rhs) const {
+		return tie(player, title, year, line) < tie(rhs.player, rhs.title, rhs.year, rhs.line);
+	}
+	size_t footprint() const { return sizeof(*this) + player.size() + title.size(); }
+	void write(FILE *file) const {
+		writeString(file, player);
+		writeString(file, title);
+		writeValue(file, year);
+		writeValue(file, line);
+	}
+	bool read(FILE *file) {
+		return readString(file, player) && readString(file, title) && readValue(file, year) && readValue(file, line);
+	}
+};
+
+struct casting {
+	string title;
+	int year;
+	int actorID;
+	long line;
+
+	bool operator<(const casting& rhs) const {
+		return tie(title, year, actorID) < tie(rhs.title, rhs.year, rhs.actorID);
+	}
+	size_t footprint() const { return sizeof(*this) + title.size(); }
+	void write(FILE *file) const {
+		writeString(file, title);
+		writeValue(file, year);
+		writeValue(file, actorID);
+		writeValue(file, line);
+	}
+	bool read(FILE *file) {
+		return readString(file, title) && readValue(file, year) && readValue(file, actorID) && readValue(file, line);
+	}
+};
+
+struct billing {
+	int actorID;
+	int movieID;
+	long line;
+
+	bool operator<(const billing& rhs) const {
+		return tie(actorID, line) < tie(rhs.actorID, rhs.line);
+	}
+	size_t footprint() const { return sizeof(*this); }
+	void write(FILE *file) const { writeValue(file, *this); }
+	bool read(FILE *file) { return readValue(file, *this); }
+};
+
+/**
+ * Class: runsorter
+ * ----------------
+ * An external merge sort.  Records are collected in memory until they
+ * take up the memory budget, at which point they're sorted and written out
+ * as a run to a scratch file.  Once every record has been added, finish
+ * frees the memory and starts a merge of the runs, and next hands back the
+ * records in sorted order.  Whenever the runs grow too numerous to merge at
+ * once, they're merged down into a single run before any more are written.
+ * Only one sorter is ever filling at a time, so each gets the whole budget.
+ */
+template <typename Record>
+class runsorter {
+ public:
+	runsorter(const string& scratchDirectory, size_t memoryBudget) :
+		scratchDirectory(scratchDirectory), memoryBudget(memoryBudget), bufferSize(0), runCount(0), failed(false) {}
+
+	~runsorter() {
+		for (size_t i = 0; i < runs.size(); i++) fclose(runs[i]);
+	}
+
+	bool add(const Record& record) {
+		buffer.push_back(record);
+		bufferSize += record.footprint();
+		return bufferSize < memoryBudget || spill();
+	}
+
+	bool finish() {
+		if (!buffer.empty() || runs.empty()) spill();
+		vector<Record>().swap(buffer);
+		if (!failed) startMerge();
+		return !failed;
+	}
+
+	bool next(Record& record) {
+		if (pending.empty()) return false;
+		record = pending.top().record;
+		size_t run = pending.top().run;
+		pending.pop();
+		pushNext(run);
+		return true;
+	}
+
+	size_t getRunCount() const { return runCount; }
+
+ private:
+	struct head {
+		Record record;
+		size_t run;
+		bool operator<(const head& rhs) const { return rhs.record < record; }
+	};
+
+	string scratchDirectory;
+	size_t memoryBudget;
+	size_t bufferSize;
+	size_t runCount;
+	bool failed;
+	vector<Record> buffer;
+	vector<FILE *> runs;
+	priority_queue<head> pending;
+
+	bool spill() {
+		FILE *run = openScratchFile(scratchDirectory);
+		if (run == NULL) return !(failed = true);
+		sort(buffer.begin(), buffer.end());
+		for (size_t i = 0; i < buffer.size(); i++) buffer[i].write(run);
+		buffer.clear();
+		bufferSize = 0;
+		runs.push_back(run);
+		runCount++;
+		if (fflush(run) != 0 || ferror(run)) return !(failed = true);
+		if (runs.size() >= kMaxMergeWidth) collapse();
+		return !failed;
+	}
+
+	void collapse() {
+		FILE *merged = openScratchFile(scratchDirectory);
+		if (merged == NULL) {
+			failed = true;
+			return;
+		}
+		startMerge();
+		Record record;
+		while (next(record)) record.write(merged);
+		for (size_t i = 0; i < runs.size(); i++) fclose(runs[i]);
+		runs.assign(1, merged);
+		if (fflush(merged) != 0 || ferror(merged)) failed = true;
+	}
+
+	void startMerge() {
+		pending = priority_queue<head>();
+		for (size_t i = 0; i < runs.size(); i++) {
+			rewind(runs[i]);
+			pushNext(i);
+		}
+	}
+
+	void pushNext(size_t run) {
+		head next;
+		next.run = run;
+		if (next.record.read(runs[run])) pending.push(next);
+	}
+};
+
+/**
+ * Function: readCredits
+ * ---------------------
+ * Reads lines of the form <actor><TAB><title><TAB><year>, skipping blank
+ * lines and those starting with '#', and adds each as a credit.  Lines are
+ * numbered across all of the input files.  Returns false if any line is
+ * malformed, explaining why in error, or if the scratch files can't be
+ * written, leaving error empty.
+ */
+static bool readCredits(istream& in, const string& fileName, long& line, runsorter<credit>& credits,
+		long& numCredits, string& error) {
+	string text;
+	for (long lineInFile = 1; getline(in, text); lineInFile++, line++) {
+		if (!text.empty() && text[text.size() - 1] == '\r') text.erase(text.size() - 1);
+		if (text.empty() || text[0] == '#') continue;
+		string where = fileName + ":" + to_string(lineInFile) + ": ";
+		size_t first = text.find('\t'), second = text.find('\t', first + 1);
+		if (first == string::npos || second == string::npos || text.find('\t', second + 1) != string::npos) {
+			error = where + "expected <actor><TAB><title><TAB><year>";
+			return false;
+		}
+		credit c;
+		c.player = text.substr(0, first);
+		c.title = text.substr(first + 1, second - first - 1);
+		string year = text.substr(second + 1);
+		char *end;
+		c.year = strtol(year.c_str(), &end, 10);
+		c.line = line;
+		if (c.player.empty() || c.title.empty() || c.player.find('\0') != string::npos ||
+			c.title.find('\0') != string::npos) {
+			error = where + "names must be non-empty and can't contain '\\0'";
+			return false;
+		}
+		if (year.empty() || *end != '\0' || c.year < kFirstYear || c.year > kLastYear) {
+			error = where + "the year must be between " + to_string(kFirstYear) + " and " + to_string(kLastYear);
+			return false;
+		}
+		if (!credits.add(c)) return false;
+		numCredits++;
+	}
+	return true;
+}
+
+/**
+ * Function: numberActors
+ * ----------------------
+ * Merges the credits into actor order, drops duplicates (keeping the first)
+ * and numbers the actors/actresses in name order, which is the order of their
+ * IDs in the finished database.  Writes each actor/actress's name and credit
+ * count to the actor list and passes each credit on as a casting.  Returns
+ * false if an actor/actress has too many credits, explaining why in error,
+ * or if the scratch files can't be written.
+ */
+static bool numberActors(runsorter<credit>& credits, FILE *actorList, runsorter<casting>& castings,
+		int& actorCount, long& duplicates, string& error) {
+	credit curr, prev;
+	int count = 0;
+	actorCount = 0;
+	for (bool more = credits.next(curr); more || count > 0; more = credits.next(curr)) {
+		if (count > 0 && (!more || curr.player != prev.player)) {
+			if (count > kMaxEntries) {
+				error = prev.player + " has more than " + to_string(kMaxEntries) + " credits";
+				return false;
+			}
+			writeString(actorList, prev.player);
+			writeValue(actorList, count);
+			actorCount++;
+			count = 0;
+		}
+		if (!more) break;
+		if (count > 0 && curr.title == prev.title && curr.year == prev.year) {
+			duplicates++;
+			continue;
+		}
+		casting c = { curr.title, curr.year, actorCount, curr.line };
+		if (!castings.add(c)) return false;
+		count++;
+		prev = curr;
+	}
+	return true;
+}
+
+/**
+ * Function: numberMovies
+ * ----------------------
+ * Merges the castings into movie order and numbers the movies.  Writes each
+ * movie's title, year and cast count to the movie list and the IDs of its
+ * cast to castIDs, and passes each credit on as a billing.  Fails just as
+ * numberActors does.
+ */
+static bool numberMovies(runsorter<casting>& castings, FILE *movieList, FILE *castIDs,
+		runsorter<billing>& billings, int& movieCount, string& error) {
+	casting curr, prev;
+	int count = 0;
+	movieCount = 0;
+	for (bool more = castings.next(curr); more || count > 0; more = castings.next(curr)) {
+		if (count > 0 && (!more || curr.title != prev.title || curr.year != prev.year)) {
+			if (count > kMaxEntries) {
+				error = prev.title + " (" + to_string(prev.year) + ") has more than " + to_string(kMaxEntries) +
+					" cast members";
+				return false;
+			}
+			writeString(movieList, prev.title);
+			writeValue(movieList, prev.year);
+			writeValue(movieList, count);
+			movieCount++;
+			count = 0;
+		}
+		if (!more) break;
+		writeValue(castIDs, curr.actorID);
+		billing b = { curr.actorID, movieCount, curr.line };
+		if (!billings.add(b)) return false;
+		count++;
+		prev = curr;
+	}
+	return true;
+}
+
+/**
+ * Functions: actorRecordSize / movieRecordSize
+ * --------------------------------------------
+ * The number of bytes an actor or movie record takes up, laid out as
+ * imdb.cc decodes them.  Both always come to a multiple of four bytes.
+ */
+static size_t actorRecordSize(size_t nameLength, int count) {
+	size_t size = nameLength + 1;
+	if (size % 2 == 1) size++;
+	size += sizeof(short);
+	if (size % 4 == 2) size += 2;
+	return size + count * sizeof(int);
+}
+
+static size_t movieRecordSize(size_t titleLength, int count) {
+	size_t size = titleLength + 2;
+	if (size % 2 == 1) size++;
+	size += sizeof(short);
+	if (size % 4 == 2) size += 2;
+	return size + count * sizeof(int);
+}
+
+/**
+ * Function: computeOffsets
+ * ------------------------
+ * Reads back an actor or movie list and lays out the records it describes
+ * one after the other, just past the offset table, recording the offset of
+ * each.  Returns false if the file would be too big for int offsets.
+ */
+static bool computeOffsets(FILE *list, bool isMovieList, int count, vector<int>& offsets) {
+	offsets.clear();
+	offsets.reserve(count);
+	size_t offset = sizeof(int) * ((size_t) count + 1);
+	rewind(list);
+	string name;
+	int year, entries;
+	for (int i = 0; i < count; i++) {
+		if (!readString(list, name) || (isMovieList && !readValue(list, year)) || !readValue(list, entries)) {
+			return false;
+		}
+		offsets.push_back(offset);
+		offset += isMovieList ? movieRecordSize(name.size(), entries) : actorRecordSize(name.size(), entries);
+		if (offset > (size_t) INT_MAX) return false;
+	}
+	return true;
+}
+
+/**
+ * Function: writeDataFile
+ * -----------------------
+ * Writes an actordata or moviedata file: the record count, the offset table
+ * and then the records, each listing the offsets (in the other file) of the
+ * entries read from entryIDs, followed by the stamp both files share.
+ */
+static bool writeDataFile(const string& fileName, FILE *list, FILE *entryIDs, bool isMovieFile,
+		const vector<int>& offsets, const vector<int>& otherOffsets, const imdb::dataStamp& stamp) {
+	FILE *out = fopen(fileName.c_str(), "wb");
+	if (out == NULL) return false;
+	writeValue<int>(out, offsets.size());
+	fwrite(offsets.data(), sizeof(int), offsets.size(), out);
+
+	rewind(list);
+	rewind(entryIDs);
+	string name;
+	int year = 0, entries;
+	vector<char> record;
+	bool success = true;
+	for (size_t i = 0; i < offsets.size() && success; i++) {
+		success = readString(list, name) && (!isMovieFile || readValue(list, year)) && readValue(list, entries);
+		if (!success) break;
+		record.assign(name.begin(), name.end());
+		record.push_back('\0');
+		if (isMovieFile) record.push_back(year - kFirstYear);
+		if (record.size() % 2 == 1) record.push_back('\0');
+		short count = entries;
+		record.insert(record.end(), (const char *) &count, (const char *) &count + sizeof(count));
+		if (record.size() % 4 == 2) record.insert(record.end(), 2, '\0');
+		for (int j = 0; j < entries && success; j++) {
+			int id;
+			success = readValue(entryIDs, id) && id >= 0 && (size_t) id < otherOffsets.size();
+			if (success) record.insert(record.end(), (const char *) &otherOffsets[id],
+				(const char *) &otherOffsets[id] + sizeof(int));
+		}
+		fwrite(record.data(), 1, record.size(), out);
+	}
+	fwrite(&stamp, sizeof(stamp), 1, out);
+	success = !ferror(out) && success;
+	return fclose(out) == 0 && success;
+}
+
+static void printUsage(const char *progname) {
+	cerr << "Usage: " << progname << " [-o output-directory] [-t scratch-directory] [-m memory-MB] "
+		<< "[credits-file ...]" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	string outputDirectory = ".";
+	string scratchDirectory;
+	size_t memoryMB = kDefaultMemoryMB;
+	int opt;
+	while ((opt = getopt(argc, argv, "o:t:m:")) != -1) {
+		switch (opt) {
+		case 'o':
+			outputDirectory = optarg;
+			break;
+		case 't':
+			scratchDirectory = optarg;
+			break;
+		case 'm':
+			memoryMB = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			printUsage(argv[0]);
+			return kWrongArgumentCount;
+		}
+	}
+	if (memoryMB < 1) {
+		printUsage(argv[0]);
+		return kWrongArgumentCount;
+	}
+	if (scratchDirectory.empty()) scratchDirectory = outputDirectory;
+
+	size_t memoryBudget = memoryMB * 1024 * 1024;
+	runsorter<credit> credits(scratchDirectory, memoryBudget);
+	long line = 1, numCredits = 0;
+	string error;
+	bool success = true;
+	if (optind == argc) success = readCredits(cin, "<stdin>", line, credits, numCredits, error);
+	for (int i = optind; i < argc && success; i++) {
+		ifstream infile(argv[i]);
+		if (!infile) {
+			cerr << "Credits file \"" << argv[i] << "\" not found!  Aborting..." << endl;
+			return kCreditsNotFound;
+		}
+		success = readCredits(infile, argv[i], line, credits, numCredits, error);
+	}
+
+	// number the actors, then the movies, then gather each actor's credits back in input order
+	FILE *actorList = openScratchFile(scratchDirectory);
+	FILE *movieList = openScratchFile(scratchDirectory);
+	FILE *castIDs = openScratchFile(scratchDirectory);
+	FILE *creditIDs = openScratchFile(scratchDirectory);
+	int actorCount, movieCount;
+	long duplicates = 0;
+	runsorter<casting> castings(scratchDirectory, memoryBudget);
+	runsorter<billing> billings(scratchDirectory, memoryBudget);
+	success = success && actorList != NULL && movieList != NULL && castIDs != NULL && creditIDs != NULL &&
+		credits.finish() && numberActors(credits, actorList, castings, actorCount, duplicates, error) &&
+		castings.finish() && numberMovies(castings, movieList, castIDs, billings, movieCount, error) &&
+		billings.finish();
+	billing b;
+	while (success && billings.next(b)) writeValue(creditIDs, b.movieID);
+	if (!error.empty()) {
+		cerr << error << "!  Aborting..." << endl;
+		return kMalformedCredits;
+	}
+	if (!success) {
+		cerr << "Couldn't write to the scratch directory \"" << scratchDirectory << "\"!  Aborting..." << endl;
+		return kDatabaseNotWritten;
+	}
+
+	// lay out both files, so that each can be written with the other's offsets
+	vector<int> actorOffsets, movieOffsets;
+	FILE *const scratchFiles[] = {actorList, movieList, castIDs, creditIDs};
+	for (size_t i = 0; i < sizeof(scratchFiles) / sizeof(scratchFiles[0]); i++) {
+		if (fflush(scratchFiles[i]) != 0 || ferror(scratchFiles[i])) {
+			cerr << "Couldn't write to the scratch directory \"" << scratchDirectory << "\"!  Aborting..." << endl;
+			return kDatabaseNotWritten;
+		}
+	}
+	if (!computeOffsets(actorList, false, actorCount, actorOffsets) ||
+		!computeOffsets(movieList, true, movieCount, movieOffsets)) {
+		cerr << "Couldn't lay out the data files (they may be too large)!  Aborting..." << endl;
+		return kDatabaseNotWritten;
+	}
+
+	// write both files under temporary names, stamped as one build, then rename them into place
+	imdb::dataStamp stamp;
+	memcpy(stamp.magic, imdb::kDataStampMagic, sizeof(stamp.magic));
+	stamp.generation = chrono::system_clock::now().time_since_epoch().count() ^ ((long long) getpid() << 40);
+	const string actorFileName = outputDirectory + "/" + imdb::kActorFileName;
+	const string movieFileName = outputDirectory + "/" + imdb::kMovieFileName;
+	success = writeDataFile(actorFileName + ".tmp", actorList, creditIDs, false, actorOffsets, movieOffsets,
+			stamp) &&
+		writeDataFile(movieFileName + ".tmp", movieList, castIDs, true, movieOffsets, actorOffsets, stamp) &&
+		rename((movieFileName + ".tmp").c_str(), movieFileName.c_str()) == 0 &&
+		rename((actorFileName + ".tmp").c_str(), actorFileName.c_str()) == 0;
+	for (size_t i = 0; i < sizeof(scratchFiles) / sizeof(scratchFiles[0]); i++) fclose(scratchFiles[i]);
+	if (!success) {
+		unlink((actorFileName + ".tmp").c_str());
+		unlink((movieFileName + ".tmp").c_str());
+		cerr << "Couldn't write the data files to \"" << outputDirectory << "\"!  Aborting..." << endl;
+		return kDatabaseNotWritten;
+	}
+
+	cout << "Built " << actorCount << " actors and " << movieCount << " movies from " << numCredits
+		<< " credits (" << duplicates << " duplicates dropped, " << credits.getRunCount()
+		<< " sorted runs) into " << outputDirectory << endl;
+	imdb db(outputDirectory, false);
+	if (!db.good()) {
+		cerr << "Warning: imdb can't open the new data files: " << db.getError() << endl;
+		return kDatabaseNotWritten;
+	}
+	return 0;
+}
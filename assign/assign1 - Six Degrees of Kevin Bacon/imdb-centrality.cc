@@ -0,0 +1,125 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <getopt.h>
+#include "imdb.h"
+#include "search-engine.h"
+using namespace std;
+
+static const int kWrongArgumentCount = 1;
+static const int kDatabaseNotFound = 2;
+static const int kActorNotFound = 3;
+static const int kDistanceFileNotWritten = 4;
+
+/**
+ * Function: writeDistances
+ * ------------------------
+ * Writes one line per actor/actress, in ID (and therefore name) order, of
+ * the form <name><TAB><distance>, where the distance of anyone unreachable
+ * is written as "-".
+ */
+static bool writeDistances(const imdb& db, const vector<int>& distances, const string& fileName) {
+	ofstream outfile(fileName.c_str());
+	if (!outfile) return false;
+	for (unsigned int i = 0; i < distances.size(); i++) {
+		outfile << db.getActorName(i) << '\t';
+		if (distances[i] == kUnreachable) outfile << '-';
+		else outfile << distances[i];
+		outfile << '\n';
+	}
+	outfile.close();
+	return !outfile.fail();
+}
+
+/**
+ * Function: printHistogram
+ * ------------------------
+ * Prints the number of actors/actresses at each distance from the hub,
+ * along with the number who can't be reached at all and the average
+ * distance of the others who can.
+ */
+static void printHistogram(const string& hub, const vector<int>& distances) {
+	vector<size_t> counts;
+	size_t unreachable = 0;
+	double total = 0;
+	for (unsigned int i = 0; i < distances.size(); i++) {
+		if (distances[i] == kUnreachable) {
+			unreachable++;
+			continue;
+		}
+		if ((size_t) distances[i] >= counts.size()) counts.resize(distances[i] + 1, 0);
+		counts[distances[i]]++;
+		total += distances[i];
+	}
+
+	// The hub is at distance 0 and isn't counted in the average.
+	size_t reachable = distances.size() - unreachable;
+	size_t others = reachable > 0 ? reachable - 1 : 0;
+	cout << "Distances from " << hub << " to all " << distances.size() << " actors:" << endl << endl;
+	cout << setw(10) << "distance" << setw(12) << "actors" << setw(10) << "percent" << endl;
+	for (unsigned int d = 0; d < counts.size(); d++) {
+		cout << setw(10) << d << setw(12) << counts[d] << setw(9) << fixed << setprecision(2)
+			<< 100.0 * counts[d] / distances.size() << "%" << endl;
+	}
+	cout << setw(10) << "-" << setw(12) << unreachable << setw(9) << fixed << setprecision(2)
+		<< 100.0 * unreachable / distances.size() << "%" << endl << endl;
+	cout << "Average distance (of the " << others << " others reachable): " << setprecision(3)
+		<< (others > 0 ? total / others : 0.0) << endl;
+}
+
+static void printUsage(const char *progname) {
+	cerr << "Usage: " << progname << " [-d data-directory] [-o distance-file] <hub-actor>" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	string directory = kIMDBDataDirectory;
+	string distanceFile;
+	int opt;
+	while ((opt = getopt(argc, argv, "d:o:")) != -1) {
+		switch (opt) {
+		case 'd':
+			directory = optarg;
+			break;
+		case 'o':
+			distanceFile = optarg;
+			break;
+		default:
+			printUsage(argv[0]);
+			return kWrongArgumentCount;
+		}
+	}
+	if (argc - optind != 1) {
+		printUsage(argv[0]);
+		return kWrongArgumentCount;
+	}
+
+	imdb db(directory);
+	if (!db.good()) {
+		cerr << db.getError() << "!  Aborting..." << endl;
+		return kDatabaseNotFound;
+	}
+	string hub = argv[optind];
+	int hubID = db.getActorID(hub);
+	if (hubID == imdb::kNoID) {
+		cerr << hub << " doesn't appear to be in our database." << endl;
+		return kActorNotFound;
+	}
+
+	vector<int> distances;
+	searchstats stats;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	computeDistances(db, hubID, distances, &stats);
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	printHistogram(hub, distances);
+	cout << "Expanded " << stats.actorsExpanded << " actors and " << stats.moviesExpanded
+		<< " movies in " << setprecision(3) << elapsed.count() << "s" << endl;
+
+	if (!distanceFile.empty() && !writeDistances(db, distances, distanceFile)) {
+		cerr << "Couldn't write the distances to \"" << distanceFile << "\"!  Aborting..." << endl;
+		return kDistanceFileNotWritten;
+	}
+	return 0;
+}
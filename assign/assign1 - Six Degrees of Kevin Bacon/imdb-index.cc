@@ -0,0 +1,55 @@
+#include <iostream>
+#include <string>
+#include <getopt.h>
+#include "imdb.h"
+using namespace std;
+
+static const int kWrongArgumentCount = 1;
+static const int kDatabaseNotFound = 2;
+static const int kIndexNotWritten = 3;
+
+static void printUsage(const char *progname) {
+	cerr << "Usage: " << progname << " [-d data-directory] [-o index-file]" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	string directory = kIMDBDataDirectory;
+	string indexFile;
+	int opt;
+	while ((opt = getopt(argc, argv, "d:o:")) != -1) {
+		switch (opt) {
+		case 'd':
+			directory = optarg;
+			break;
+		case 'o':
+			indexFile = optarg;
+			break;
+		default:
+			printUsage(argv[0]);
+			return kWrongArgumentCount;
+		}
+	}
+	if (optind != argc) {
+		printUsage(argv[0]);
+		return kWrongArgumentCount;
+	}
+	if (indexFile.empty()) indexFile = directory + "/" + imdb::kIndexFileName;
+
+	// always build from the raw records, never from an older index
+	imdb db(directory, false);
+	if (!db.good()) {
+		cerr << db.getError() << "!  Aborting..." << endl;
+		return kDatabaseNotFound;
+	}
+	if (!db.buildIndex(indexFile)) {
+		cerr << "Couldn't write the index to \"" << indexFile << "\"!  Aborting..." << endl;
+		return kIndexNotWritten;
+	}
+
+	cout << "Indexed " << db.getActorCount() << " actors and " << db.getMovieCount()
+		<< " movies into " << indexFile << endl;
+	if (indexFile == directory + "/" + imdb::kIndexFileName && !imdb(directory).hasIndex()) {
+		cerr << "Warning: the new index isn't being picked up by imdb." << endl;
+	}
+	return 0;
+}
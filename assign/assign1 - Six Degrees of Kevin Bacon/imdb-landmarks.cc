@@ -0,0 +1,169 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <utility>
+#include <cstdlib>
+#include <getopt.h>
+#include "imdb.h"
+#include "path.h"
+#include "search-engine.h"
+using namespace std;
+
+static const int kWrongArgumentCount = 1;
+static const int kDatabaseNotFound = 2;
+static const int kLandmarksNotWritten = 3;
+static const int kCheckFailed = 4;
+static const int kDefaultLandmarkCount = 16;
+
+/**
+ * Function: chooseLandmarks
+ * -------------------------
+ * Picks the numLandmarks best-connected actors/actresses, measured by the
+ * total size of the casts they've appeared in.  Shortest paths tend to run
+ * through such hubs, which keeps the upper bounds tight.
+ */
+static vector<int> chooseLandmarks(const imdb& db, int numLandmarks) {
+	vector<pair<long, int>> scores;
+	for (int i = 0; i < db.getActorCount(); i++) {
+		long score = 0;
+		idspan credits = db.getCreditIDs(i);
+		for (idspan::iterator it = credits.begin(); it != credits.end(); ++it) {
+			score += db.getCastIDs(*it).size();
+		}
+		if (score > 0) scores.push_back(make_pair(-score, i));
+	}
+	numLandmarks = min<int>(numLandmarks, scores.size());
+	partial_sort(scores.begin(), scores.begin() + numLandmarks, scores.end());
+	vector<int> landmarks;
+	for (int i = 0; i < numLandmarks; i++) landmarks.push_back(scores[i].second);
+	return landmarks;
+}
+
+/**
+ * Function: measureLandmarks
+ * --------------------------
+ * Runs one full breadth-first search per landmark and lays the distances
+ * out actor by actor, as imdb::buildLandmarks expects them.  Returns false
+ * if some distance is too long to be stored in a byte.
+ */
+static bool measureLandmarks(const imdb& db, const vector<int>& landmarks, vector<unsigned char>& distances) {
+	size_t numLandmarks = landmarks.size();
+	distances.assign((size_t) db.getActorCount() * numLandmarks, imdb::kNoDistance);
+	vector<int> fromLandmark;
+	for (size_t k = 0; k < numLandmarks; k++) {
+		computeDistances(db, landmarks[k], fromLandmark);
+		for (size_t i = 0; i < fromLandmark.size(); i++) {
+			if (fromLandmark[i] == kUnreachable) continue;
+			if (fromLandmark[i] >= imdb::kNoDistance) return false;
+			distances[i * numLandmarks + k] = fromLandmark[i];
+		}
+	}
+	return true;
+}
+
+/**
+ * Function: checkLandmarks
+ * ------------------------
+ * Compares, for numPairs random pairs of actors/actresses, the distance the
+ * plain breadth-first search finds against the landmark bounds, findDistance
+ * and the pruned bidirectional search.  Prints every disagreement and
+ * returns the number of pairs that had any.
+ */
+static int checkLandmarks(const imdb& db, int numPairs, unsigned seed) {
+	mt19937 generator(seed);
+	uniform_int_distribution<int> pickActor(0, db.getActorCount() - 1);
+	int failures = 0, disconnected = 0, exact = 0;
+	for (int i = 0; i < numPairs; i++) {
+		int sourceID = pickActor(generator), targetID = pickActor(generator);
+		string source = db.getActorName(sourceID), target = db.getActorName(targetID);
+		path plain(source), pruned(source);
+		int expected = findShortestPath(db, source, target, plain) ? (int) plain.getLength() : kUnreachable;
+		int lower, upper;
+		bool connected = landmarkBounds(db, sourceID, targetID, lower, upper);
+		int distance = findDistance(db, source, target);
+		int prunedLength = findShortestPathBidirectional(db, source, target, pruned) ?
+			(int) pruned.getLength() : kUnreachable;
+
+		bool bounded = expected == kUnreachable ? true : connected && lower <= expected && expected <= upper;
+		if (!bounded || distance != expected || prunedLength != expected) {
+			cout << source << " -> " << target << ": bfs " << expected << ", bounds [" << lower << ", "
+				<< upper << "]" << (connected ? "" : " (disconnected)") << ", findDistance " << distance
+				<< ", bidirectional " << prunedLength << endl;
+			failures++;
+		}
+		if (!connected) disconnected++;
+		else if (lower == upper) exact++;
+	}
+	cout << "Checked " << numPairs << " random pairs: " << failures << " disagreed, "
+		<< exact << " answered exactly by the bounds, " << disconnected
+		<< " shown disconnected by the landmarks." << endl;
+	return failures;
+}
+
+static void printUsage(const char *progname) {
+	cerr << "Usage: " << progname << " [-d data-directory] [-k landmarks] [-o landmark-file] "
+		<< "[-c pairs-to-check] [-s seed]" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	string directory = kIMDBDataDirectory;
+	string landmarkFile;
+	int numLandmarks = kDefaultLandmarkCount;
+	int numChecks = 0;
+	unsigned seed = 110;
+	int opt;
+	while ((opt = getopt(argc, argv, "d:k:o:c:s:")) != -1) {
+		switch (opt) {
+		case 'd':
+			directory = optarg;
+			break;
+		case 'k':
+			numLandmarks = atoi(optarg);
+			break;
+		case 'o':
+			landmarkFile = optarg;
+			break;
+		case 'c':
+			numChecks = atoi(optarg);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			printUsage(argv[0]);
+			return kWrongArgumentCount;
+		}
+	}
+	if (optind != argc || numLandmarks < 1 || numChecks < 0) {
+		printUsage(argv[0]);
+		return kWrongArgumentCount;
+	}
+	string defaultFile = directory + "/" + imdb::kLandmarkFileName;
+	if (landmarkFile.empty()) landmarkFile = defaultFile;
+
+	imdb db(directory);
+	if (!db.good()) {
+		cerr << db.getError() << "!  Aborting..." << endl;
+		return kDatabaseNotFound;
+	}
+	vector<int> landmarks = chooseLandmarks(db, numLandmarks);
+	vector<unsigned char> distances;
+	if (landmarks.empty() || !measureLandmarks(db, landmarks, distances) ||
+		!db.buildLandmarks(landmarkFile, landmarks, distances)) {
+		cerr << "Couldn't write the landmarks to \"" << landmarkFile << "\"!  Aborting..." << endl;
+		return kLandmarksNotWritten;
+	}
+	cout << "Wrote distances from " << landmarks.size() << " landmarks to " << db.getActorCount()
+		<< " actors into " << landmarkFile << endl;
+	if (landmarkFile != defaultFile) return 0;
+
+	imdb reopened(directory);
+	if (!reopened.hasLandmarks()) {
+		cerr << "Warning: the new landmarks aren't being picked up by imdb." << endl;
+		return numChecks > 0 ? kCheckFailed : 0;
+	}
+	if (numChecks > 0 && checkLandmarks(reopened, numChecks, seed) > 0) return kCheckFailed;
+	return 0;
+}
@@ -5,175 +5,757 @@
 #include <unistd.h>
 #include "imdb.h"
 
+#include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <algorithm>
 #include <iterator>
+#include <utility>
 using namespace std;
 
 const char *const imdb::kActorFileName = "actordata";
 const char *const imdb::kMovieFileName = "moviedata";
-imdb::imdb(const string& directory) {
+const char *const imdb::kIndexFileName = "graphindex";
+const char *const imdb::kLandmarkFileName = "landmarks";
+const char imdb::kDataStampMagic[8] = {'I', 'M', 'D', 'B', 'G', 'E', 'N', '\0'};
+const char imdb::kIndexMagic[8] = {'I', 'M', 'D', 'B', 'C', 'S', 'R', '\0'};
+const int imdb::kIndexVersion = 1;
+const char imdb::kLandmarkMagic[8] = {'I', 'M', 'D', 'B', 'L', 'M', 'K', '\0'};
+const int imdb::kLandmarkVersion = 1;
+const int imdb::kNoID;
+const unsigned char imdb::kNoDistance;
+const int imdb::kMapPolicyCount;
+const char *const imdb::kMapPolicyNames[kMapPolicyCount] = {
+	"plain", "populate", "willneed", "random", "hugepages", "anonymous"
+};
+
+bool imdb::parseMapPolicy(const string& name, mappolicy& policy) {
+	for(int i = 0; i < kMapPolicyCount; i++) {
+		if(name == kMapPolicyNames[i]) {
+			policy = (mappolicy) i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool validateDataFile(const string& fileName, const void* file, size_t fileSize, bool isMovieFile,
+	string& error);
+static bool checkDataStamps(const string& directory, const void* actorFile, size_t actorFileSize,
+	const void* movieFile, size_t movieFileSize, string& error);
+
+imdb::imdb(const string& directory, bool useIndex, mappolicy policy) : policy(policy) {
 	const string actorFileName = directory + "/" + kActorFileName;
 	const string movieFileName = directory + "/" + kMovieFileName;  
-	actorFile = acquireFileMap(actorFileName, actorInfo);
-	movieFile = acquireFileMap(movieFileName, movieInfo);
+	actorFile = movieFile = NULL;
+	movieInfo.fd = -1;
+	movieInfo.fileMap = NULL;
+	if(acquireFileMap(actorFileName, actorInfo, policy, error) &&
+			validateDataFile(actorFileName, actorInfo.fileMap, actorInfo.fileSize, false, error) &&
+			acquireFileMap(movieFileName, movieInfo, policy, error) &&
+			validateDataFile(movieFileName, movieInfo.fileMap, movieInfo.fileSize, true, error) &&
+			checkDataStamps(directory, actorInfo.fileMap, actorInfo.fileSize, movieInfo.fileMap,
+				movieInfo.fileSize, error)) {
+		actorFile = actorInfo.fileMap;
+		movieFile = movieInfo.fileMap;
+	}
+	actorIDs.count = movieIDs.count = 0;
+	indexInfo.fd = landmarkInfo.fd = -1;
+	indexInfo.fileMap = landmarkInfo.fileMap = NULL;
+	creditStart = creditMovies = castStart = castActors = NULL;
+	landmarkCount = 0;
+	landmarkIDs = NULL;
+	landmarkDistances = NULL;
+	if(good()) {
+		buildIDTable(actorFile, actorIDs, actorIDStorage);
+		buildIDTable(movieFile, movieIDs, movieIDStorage);
+		if(useIndex) {
+			attachIndex(directory);
+			attachLandmarks(directory);
+		}
+	}
 }
 
 bool imdb::good() const {
-	return !( (actorInfo.fd == -1) || 
-			(movieInfo.fd == -1) ); 
+	return error.empty();
+}
+
+const string& imdb::getError() const {
+	return error;
+}
+
+bool imdb::hasIndex() const {
+	return creditStart != NULL;
+}
+
+bool imdb::hasLandmarks() const {
+	return landmarkDistances != NULL;
+}
+
+int imdb::getLandmarkCount() const {
+	return landmarkCount;
+}
+
+int imdb::getLandmarkID(int landmark) const {
+	return landmarkIDs[landmark];
+}
+
+const unsigned char* imdb::getLandmarkDistances(int actorID) const {
+	return landmarkDistances + (size_t) actorID * landmarkCount;
 }
 
 imdb::~imdb() {
 	releaseFileMap(actorInfo);
 	releaseFileMap(movieInfo);
+	releaseFileMap(indexInfo);
+	releaseFileMap(landmarkInfo);
 }
 
-// template<class ForwardIt, class T, class Compare=std::less<> >
-// forwardIt binary_find(ForwardIt first, ForwardIt last, const T& value, Compare comp={})
-// {
-// Note: BOTH type T and the type after ForwardIt is dereferenced 
-// must be implicitly convertible to BOTH Type1 and Type2, used in Compare. 
-// This is stricter than lower_bound requirement (see above)
+/**
+ * Record decoding helpers.  An actor record is the actor's name, padded
+ * with '\0's to an even length, followed by a short movie count, padding
+ * out to a multiple of four bytes and then the movie offsets.  A movie
+ * record is the title, a single byte holding the year (less 1900), padding
+ * out to an even length, then a short actor count, padding out to a
+ * multiple of four bytes and the actor offsets.
+ */
+static int movieYearOf(const char* record_base_ptr) {
+	int movie_name_offset = strlen(record_base_ptr) + 1;
+	return ((int)*(unsigned char*)(record_base_ptr + movie_name_offset)) + 1900;
+}
 
-bool imdb::getCredits(const string& player, vector<film>& films) const { 
-	// find the total actor number
-	int total_actor_num = *(int*) actorFile;
-//	cout << "actor num: " << total_actor_num << endl;
-	int* actor_base_ptr = ((int*) actorFile) + 1;
-
-	// binary find the target actor
-	auto cmp1 = [=](const int offset, const string cstr) {
-		char* value = ((char*) actorFile) + offset; 
-		return value < cstr;	
-	};
-	auto equals = [=](const int offset, const string cstr) {
-		char* value = ((char*) actorFile) + offset; 
-		return value == cstr;	
-	};
-	auto first = std::lower_bound(actor_base_ptr, actor_base_ptr + total_actor_num, player, cmp1);
-	auto it = (first != (actor_base_ptr + total_actor_num) && equals(*first, player)) ? first : (actor_base_ptr + total_actor_num);
-
-	if(it != actor_base_ptr + total_actor_num){
-		// calculate the actor's index
-		int actor_idx = it - actor_base_ptr;
-//		cout << "relative pos: " << actor_idx << endl;
-//		cout << *it << endl;
-		int offset = *(actor_base_ptr + actor_idx);
-
-		// find the actor's name
-		char* record_base_ptr = ((char*) actorFile) + offset;
-//		cout << "actor: " << record_base_ptr << endl;
-		int name_offset = strlen(record_base_ptr);
-		if(name_offset % 2 == 0) {
-			name_offset += 2;
-		} else {
-			name_offset += 1;
-		}
+static const int* creditsOf(const char* record_base_ptr, short& movie_num) {
+	// find the actor's name
+	int name_offset = strlen(record_base_ptr);
+	if(name_offset % 2 == 0) {
+		name_offset += 2;
+	} else {
+		name_offset += 1;
+	}
 
-		// find the actor's movie num
-		short movie_num = *(short*)(record_base_ptr + name_offset);
-		int name_num_offset = name_offset + 2;
-		if(name_num_offset % 4 == 2) {
-			name_num_offset += 2;
+	// find the actor's movie num
+	movie_num = *(short*)(record_base_ptr + name_offset);
+	int name_num_offset = name_offset + 2;
+	if(name_num_offset % 4 == 2) {
+		name_num_offset += 2;
+	}
+	return (const int*)(record_base_ptr + name_num_offset);
+}
+
+static const int* castOf(const char* record_base_ptr, short& actor_num) {
+	// find the movie's name
+	int name_offset = strlen(record_base_ptr) + 1;
+	int name_year_offset = name_offset + 1;
+	if(name_year_offset % 2 == 1) {
+		name_year_offset += 1;
+	}
+
+	// find the movie's actor num
+	actor_num = *(short*)(record_base_ptr + name_year_offset);
+	int name_year_num_offset = name_year_offset + 2;
+	if(name_year_num_offset % 4 == 2) {
+		name_year_num_offset += 2;
+	}
+	return (const int*)(record_base_ptr + name_year_num_offset);
+}
+
+int imdb::getActorCount() const {
+	return *(int*) actorFile;
+}
+
+int imdb::getMovieCount() const {
+	return *(int*) movieFile;
+}
+
+/**
+ * Comparisons made directly against the records in the mapped files, so a
+ * lookup never copies a name out into a string or a film.  Each takes the
+ * offset of a record, as stored in the file's offset table.
+ */
+static int compareActor(const char* file, int offset, const char* player) {
+	return strcmp(file + offset, player);
+}
+
+static int compareMovie(const char* file, int offset, const film& movie) {
+	const char* record_base_ptr = file + offset;
+	int order = strcmp(record_base_ptr, movie.title.c_str());
+	if(order != 0) return order;
+	return movieYearOf(record_base_ptr) - movie.year;
+}
+
+/**
+ * Hashes used by the name index (FNV-1a).  A movie's hash covers its title
+ * and year.
+ */
+static size_t hashName(const char* name, size_t length) {
+	size_t hash = 2166136261u;
+	for(size_t i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+	}
+	return hash;
+}
+
+static size_t hashMovie(const char* title, size_t length, int year) {
+	return (hashName(title, length) ^ (unsigned) year) * 16777619u;
+}
+
+/**
+ * A name that holds a '\0' can't match any record, and would otherwise
+ * compare equal to the record named by its prefix.
+ */
+static bool isRecordName(const string& name) {
+	return strlen(name.c_str()) == name.size();
+}
+
+int imdb::getActorID(const string& player) const {
+	if(!isRecordName(player)) return kNoID;
+	if(!actorSlots.empty()) {
+		size_t mask = actorSlots.size() - 1;
+		for(size_t i = hashName(player.data(), player.size()) & mask; actorSlots[i] != kNoID; i = (i + 1) & mask) {
+			if(strcmp(actorRecord(actorSlots[i]), player.c_str()) == 0) return actorSlots[i];
 		}
+		return kNoID;
+	}
 
-		// find the actor's movies
-		int* movie_base_ptr = (int*)(record_base_ptr + name_num_offset);
-		for(int i = 0; i < movie_num; i++) {
-			int movie_offset = *(movie_base_ptr + i);
-			char* movie_name = ((char*) movieFile) + movie_offset;
-//			cout << "movie name: " << movie_name << endl;
-			int movie_name_offset = strlen(movie_name) + 1;
-//			cout << "movie_name_offset: " << movie_name_offset << "!!!" << endl;
-			int movie_year = ((int)*(unsigned char*)(movie_name + movie_name_offset)) + 1900;
-//			cout << "movie year: " << movie_year << endl;
-
-			// push into the vector
-			film temp_film;
-			temp_film.title = movie_name;
-			temp_film.year = movie_year;
-			films.push_back(temp_film);
+	// binary search the offset table, which is sorted by name
+	const char* file = (const char*) actorFile;
+	const int* actor_base_ptr = ((const int*) actorFile) + 1;
+	int total_actor_num = getActorCount();
+	const int* first = std::lower_bound(actor_base_ptr, actor_base_ptr + total_actor_num, player.c_str(),
+		[file](int offset, const char* name) { return compareActor(file, offset, name) < 0; });
+	if(first != actor_base_ptr + total_actor_num && compareActor(file, *first, player.c_str()) == 0) {
+		return first - actor_base_ptr;
+	}
+	return kNoID;
+}
+
+int imdb::getMovieID(const film& movie) const {
+	if(!isRecordName(movie.title)) return kNoID;
+	if(!movieSlots.empty()) {
+		size_t mask = movieSlots.size() - 1;
+		size_t hash = hashMovie(movie.title.data(), movie.title.size(), movie.year);
+		const char* file = (const char*) movieFile;
+		const int* offsets = ((const int*) movieFile) + 1;
+		for(size_t i = hash & mask; movieSlots[i] != kNoID; i = (i + 1) & mask) {
+			if(compareMovie(file, offsets[movieSlots[i]], movie) == 0) return movieSlots[i];
 		}
-		return true;
+		return kNoID;
 	}
-	return false;
+
+	// binary search the offset table, which is sorted by title and then year
+	const char* file = (const char*) movieFile;
+	const int* movie_base_ptr = ((const int*) movieFile) + 1;
+	int total_movie_num = getMovieCount();
+	const int* first = std::lower_bound(movie_base_ptr, movie_base_ptr + total_movie_num, movie,
+		[file](int offset, const film& fi) { return compareMovie(file, offset, fi) < 0; });
+	if(first != movie_base_ptr + total_movie_num && compareMovie(file, *first, movie) == 0) {
+		return first - movie_base_ptr;
+	}
+	return kNoID;
+}
+
+/**
+ * Open addressing with linear probing, at most half full, so that a lookup
+ * (hit or miss) rarely probes more than a couple of slots, and each probe
+ * costs one comparison against a mapped record.
+ */
+static void prepareSlots(vector<int>& slots, int count) {
+	size_t size = 1;
+	while(size < 2 * (size_t) count) size <<= 1;
+	slots.assign(size, imdb::kNoID);
+}
+
+static void insertSlot(vector<int>& slots, size_t hash, int id) {
+	size_t mask = slots.size() - 1;
+	size_t i = hash & mask;
+	while(slots[i] != imdb::kNoID) i = (i + 1) & mask;
+	slots[i] = id;
+}
+
+void imdb::buildNameIndex() {
+	if(!good() || hasNameIndex()) return;
+	prepareSlots(actorSlots, getActorCount());
+	for(int i = 0; i < getActorCount(); i++) {
+		const char* name = actorRecord(i);
+		insertSlot(actorSlots, hashName(name, strlen(name)), i);
+	}
+	prepareSlots(movieSlots, getMovieCount());
+	for(int i = 0; i < getMovieCount(); i++) {
+		const char* title = movieRecord(i);
+		insertSlot(movieSlots, hashMovie(title, strlen(title), movieYearOf(title)), i);
+	}
+}
+
+bool imdb::hasNameIndex() const {
+	return !actorSlots.empty();
+}
+
+const char* imdb::actorRecord(int actorID) const {
+	return ((const char*) actorFile) + ((const int*) actorFile)[actorID + 1];
+}
+
+const char* imdb::movieRecord(int movieID) const {
+	return ((const char*) movieFile) + ((const int*) movieFile)[movieID + 1];
+}
+
+const int* imdb::creditOffsets(int actorID, short& count) const {
+	return creditsOf(actorRecord(actorID), count);
+}
+
+const int* imdb::castOffsets(int movieID, short& count) const {
+	return castOf(movieRecord(movieID), count);
+}
+
+int imdb::movieYear(const char* movieRecord) {
+	return movieYearOf(movieRecord);
+}
+
+const char* imdb::getActorName(int actorID) const {
+	return actorRecord(actorID);
+}
+
+film imdb::getMovie(int movieID) const {
+	const char* record_base_ptr = movieRecord(movieID);
+	film movie;
+	movie.title = record_base_ptr;
+	movie.year = movieYearOf(record_base_ptr);
+	return movie;
+}
+
+idspan imdb::getCreditIDs(int actorID) const {
+	if(creditStart != NULL) {
+		return idspan(creditMovies + creditStart[actorID], creditMovies + creditStart[actorID + 1], NULL);
+	}
+	short movie_num;
+	const int* movie_base_ptr = creditsOf(actorRecord(actorID), movie_num);
+	return idspan(movie_base_ptr, movie_base_ptr + movie_num, &movieIDs);
+}
+
+idspan imdb::getCastIDs(int movieID) const {
+	if(castStart != NULL) {
+		return idspan(castActors + castStart[movieID], castActors + castStart[movieID + 1], NULL);
+	}
+	short actor_num;
+	const int* actor_base_ptr = castOf(movieRecord(movieID), actor_num);
+	return idspan(actor_base_ptr, actor_base_ptr + actor_num, &actorIDs);
+}
+
+bool imdb::getCredits(const string& player, vector<film>& films) const { 
+	return forEachCredit(player, [&films](const char* title, int year) {
+		film temp_film;
+		temp_film.title = title;
+		temp_film.year = year;
+		films.push_back(temp_film);
+	});
 }
 
 bool imdb::getCast(const film& movie, vector<string>& players) const { 
-	// find the total movie num
-	int total_movie_num = *((int*) movieFile);
-//	cout << "total movie num: " << total_movie_num << endl;
-	int* movie_base_ptr = ((int*) movieFile) + 1;
-
-	// binary find the target movie
-	auto cmp1 = [=](const int offset, const film fi) {
-		char* movie_name = ((char*) movieFile) + offset; 
-		unsigned movie_name_offset = strlen(movie_name) + 1;
-		unsigned movie_year = ((unsigned)*(unsigned char*)(movie_name + movie_name_offset)) + 1900;	
-		film film_temp;
-		film_temp.title = movie_name;
-		film_temp.year = movie_year;
-		return film_temp < fi;	
-	};
-	auto equals = [=](const int offset, const film fi) {
-		char* movie_name = ((char*) movieFile) + offset; 
-		unsigned movie_name_offset = strlen(movie_name) + 1;
-		unsigned movie_year = ((unsigned)*(unsigned char*)(movie_name + movie_name_offset)) + 1900;	
-		film film_temp;
-		film_temp.title = movie_name;
-		film_temp.year = movie_year;
-		return film_temp == fi;	
-	};
-	auto first = std::lower_bound(movie_base_ptr, movie_base_ptr + total_movie_num, movie, cmp1);
-	auto it = (first != (movie_base_ptr + total_movie_num) && equals(*first, movie)) ? first : (movie_base_ptr + total_movie_num);
-	
-	if(it != movie_base_ptr + total_movie_num){
-		// calculate the movie's index
-		int movie_idx = it - movie_base_ptr;
-//		cout << "relative pos: " << movie_idx << endl;
-//		cout << *it << endl;
-		int offset = *(movie_base_ptr + movie_idx);
-
-		// find the movie's name
-		char* record_base_ptr = ((char*) movieFile) + offset;
-//		cout << "movie: " << record_base_ptr << endl;
-		int name_offset = strlen(record_base_ptr) + 1;
-		int name_year_offset = name_offset + 1;
-	    if(name_year_offset % 2 == 1) {
-			name_year_offset += 1;
-		}	
-
-		// find the movie's actor num
-		short actor_num = *(short*)(record_base_ptr + name_year_offset);
-		int name_year_num_offset = name_year_offset + 2;
-		if(name_year_num_offset % 4 == 2) {
-			name_year_num_offset += 2;
-		}
+	return forEachCast(movie, [&players](const char* name) {
+		players.push_back(name);
+	});
+}
 
-		// find the movie's actors
-		int* actor_base_ptr = (int*)(record_base_ptr + name_year_num_offset);
-		for(int i = 0; i < actor_num; i++) {
-			int actor_offset = *(actor_base_ptr + i);
-			char* actor_name = ((char*) actorFile) + actor_offset;
+static const size_t kHugePageSize = 2 * 1024 * 1024;
 
-			// push into the vector
-			players.push_back(actor_name);
+/**
+ * Copies the file into private anonymous memory rounded up to a whole number
+ * of huge pages, preferring explicit huge pages, falling back to memory
+ * advised to use transparent ones, and leaves it read-only.
+ */
+static void *loadAnonymous(int fd, size_t fileSize, size_t& mapSize) {
+	mapSize = max<size_t>((fileSize + kHugePageSize - 1) / kHugePageSize, 1) * kHugePageSize;
+	void *memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+	memory = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+	if(memory == MAP_FAILED) {
+		memory = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(memory == MAP_FAILED) return MAP_FAILED;
+#ifdef MADV_HUGEPAGE
+		madvise(memory, mapSize, MADV_HUGEPAGE);
+#endif
+	}
+	size_t loaded = 0;
+	while(loaded < fileSize) {
+		ssize_t count = pread(fd, (char*) memory + loaded, fileSize - loaded, loaded);
+		if(count == -1 && errno == EINTR) continue;
+		if(count <= 0) {
+			munmap(memory, mapSize);
+			return MAP_FAILED;
 		}
-		return true;
+		loaded += count;
 	}
-	return false; 
+	mprotect(memory, mapSize, PROT_READ);
+	return memory;
 }
 
-const void *imdb::acquireFileMap(const string& fileName, struct fileInfo& info) {
+/**
+ * Maps (or, under kMapAnonymous, loads) the named file.  On failure, the
+ * fileInfo is left holding nothing that needs releasing and error explains
+ * what went wrong.
+ */
+bool imdb::acquireFileMap(const string& fileName, struct fileInfo& info, mappolicy policy, string& error) {
+	info.fd = -1;
+	info.fileMap = NULL;
+	info.fileSize = info.mapSize = 0;
+	int fd = open(fileName.c_str(), O_RDONLY);
 	struct stat stats;
-	stat(fileName.c_str(), &stats);
+	if(fd == -1 || fstat(fd, &stats) == -1) {
+		error = fileName + ": " + strerror(errno);
+		if(fd != -1) close(fd);
+		return false;
+	}
+	if(stats.st_size == 0) {
+		error = fileName + ": file is empty";
+		close(fd);
+		return false;
+	}
+
+	size_t mapSize = stats.st_size;
+	void *map;
+	if(policy == kMapAnonymous) {
+		map = loadAnonymous(fd, stats.st_size, mapSize);
+	} else {
+		int flags = MAP_SHARED | (policy == kMapPopulate ? MAP_POPULATE : 0);
+		map = mmap(0, stats.st_size, PROT_READ, flags, fd, 0);
+		if(map != MAP_FAILED && policy == kMapWillNeed) madvise(map, stats.st_size, MADV_WILLNEED);
+		if(map != MAP_FAILED && policy == kMapRandom) madvise(map, stats.st_size, MADV_RANDOM);
+#ifdef MADV_HUGEPAGE
+		if(map != MAP_FAILED && policy == kMapHugePages) madvise(map, stats.st_size, MADV_HUGEPAGE);
+#endif
+	}
+	if(map == MAP_FAILED) {
+		error = fileName + ": " + strerror(errno);
+		close(fd);
+		return false;
+	}
+	info.fd = fd;
+	info.fileMap = map;
 	info.fileSize = stats.st_size;
-	info.fd = open(fileName.c_str(), O_RDONLY);
-	return info.fileMap = mmap(0, info.fileSize, PROT_READ, MAP_SHARED, info.fd, 0);
+	info.mapSize = mapSize;
+	return true;
 }
 
 void imdb::releaseFileMap(struct fileInfo& info) {
-	if (info.fileMap != NULL) munmap((char *) info.fileMap, info.fileSize);
+	if (info.fileMap != NULL) munmap((char *) info.fileMap, info.mapSize);
 	if (info.fd != -1) close(info.fd);
+	info.fd = -1;
+	info.fileMap = NULL;
+}
+
+/**
+ * Checks that a data file is at least self-consistent enough to be read
+ * without running off its end: the count and offset table must fit in the
+ * file, every offset must land past the table and inside the file, and the
+ * record at the highest offset must end (name, count and all) before the
+ * file does.  Since strlen from any record stops at the latest at the end
+ * of that last record's name, no name lookup can read past the mapping.
+ * The records in between aren't walked, which would fault in the whole file.
+ */
+static bool validateDataFile(const string& fileName, const void* file, size_t fileSize, bool isMovieFile,
+		string& error) {
+	const int* ints = (const int*) file;
+	if(fileSize < sizeof(int) || ints[0] < 0 || (size_t) ints[0] > fileSize / sizeof(int) - 1) {
+		error = fileName + ": record count doesn't fit in the file";
+		return false;
+	}
+	size_t tableEnd = sizeof(int) * ((size_t) ints[0] + 1);
+	int last = -1;
+	for(int i = 1; i <= ints[0]; i++) {
+		if(ints[i] < (int) tableEnd || (size_t) ints[i] >= fileSize) {
+			error = fileName + ": record offset out of range";
+			return false;
+		}
+		last = max(last, ints[i]);
+	}
+	if(last == -1) return true;
+
+	const char* record = (const char*) file + last;
+	const char* end = (const char*) file + fileSize;
+	if(memchr(record, '\0', end - record) == NULL) {
+		error = fileName + ": last record runs past the end of the file";
+		return false;
+	}
+	// the name (and year) are padded out to an even length, and followed by the short count
+	size_t length = strlen(record);
+	size_t countEnd = (isMovieFile ? (length + 3) & ~1 : (length + 2) & ~1) + sizeof(short);
+	if(record + countEnd > end) {
+		error = fileName + ": last record runs past the end of the file";
+		return false;
+	}
+	// the entries start after two more bytes of padding when the count needs
+	// them, but a record with no entries never reads them
+	short count;
+	const int* entries = isMovieFile ? castOf(record, count) : creditsOf(record, count);
+	if(count < 0 || (count > 0 && (const char*) (entries + count) > end)) {
+		error = fileName + ": last record runs past the end of the file";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Reads the stamp imdb-build leaves at the very end of a data file, returning
+ * false if there isn't one.
+ */
+static bool readDataStamp(const void* file, size_t fileSize, imdb::dataStamp& stamp) {
+	if(fileSize < sizeof(stamp)) return false;
+	memcpy(&stamp, (const char*) file + fileSize - sizeof(stamp), sizeof(stamp));
+	return memcmp(stamp.magic, imdb::kDataStampMagic, sizeof(stamp.magic)) == 0;
+}
+
+/**
+ * Checks that the two data files come from the same build: either both carry
+ * the same stamp or, as with hand-made or older files, neither does.  Each
+ * file is self-consistent on its own, but the offsets in one are only
+ * meaningful against the other file it was built with.
+ */
+static bool checkDataStamps(const string& directory, const void* actorFile, size_t actorFileSize,
+		const void* movieFile, size_t movieFileSize, string& error) {
+	imdb::dataStamp actorStamp, movieStamp;
+	bool actorStamped = readDataStamp(actorFile, actorFileSize, actorStamp);
+	bool movieStamped = readDataStamp(movieFile, movieFileSize, movieStamp);
+	if(actorStamped != movieStamped || (actorStamped && actorStamp.generation != movieStamp.generation)) {
+		error = directory + ": " + imdb::kActorFileName + " and " + imdb::kMovieFileName +
+			" are from different builds";
+		return false;
+	}
+	return true;
+}
+
+/**
+ * The offset table is sorted by name, and in every data file we've seen the
+ * records are laid out in that same order, so the table is also sorted by
+ * offset and the position of an offset within it is the ID.  Should that
+ * ever not hold, a sorted copy of the offsets and their IDs is built instead.
+ */
+void imdb::buildIDTable(const void *file, idtable& table, vector<int>& storage) {
+	table.count = *(const int*) file;
+	table.offsets = ((const int*) file) + 1;
+	table.ids = NULL;
+	if(std::is_sorted(table.offsets, table.offsets + table.count)) return;
+
+	vector<pair<int, int>> byOffset(table.count);
+	for(int i = 0; i < table.count; i++) {
+		byOffset[i] = make_pair(table.offsets[i], i);
+	}
+	sort(byOffset.begin(), byOffset.end());
+	storage.resize(2 * table.count);
+	for(int i = 0; i < table.count; i++) {
+		storage[i] = byOffset[i].first;
+		storage[table.count + i] = byOffset[i].second;
+	}
+	table.offsets = storage.data();
+	table.ids = storage.data() + table.count;
+}
+
+/**
+ * A derived file (the adjacency index or the landmarks) is only trusted if
+ * it's at least as new as both data files, which catches data files that
+ * were rebuilt in place without changing size.
+ */
+static bool isNewerThanData(const string& fileName, const string& actorFileName, const string& movieFileName) {
+	struct stat derived_stats, actor_stats, movie_stats;
+	if(stat(fileName.c_str(), &derived_stats) == -1 ||
+			stat(actorFileName.c_str(), &actor_stats) == -1 ||
+			stat(movieFileName.c_str(), &movie_stats) == -1) return false;
+	return derived_stats.st_mtime >= actor_stats.st_mtime && derived_stats.st_mtime >= movie_stats.st_mtime;
+}
+
+/**
+ * Checks one half of the adjacency index: the count + 1 offsets must start at
+ * 0, never decrease and end at total, and each of the total neighbor IDs must
+ * name one of the limit records on the other side.
+ */
+static bool isValidAdjacency(const int *start, int count, const int *neighbors, int total, int limit) {
+	if(start[0] != 0 || start[count] != total) return false;
+	for(int i = 0; i < count; i++) {
+		if(start[i] > start[i + 1]) return false;
+	}
+	for(int i = 0; i < total; i++) {
+		if(neighbors[i] < 0 || neighbors[i] >= limit) return false;
+	}
+	return true;
+}
+
+/**
+ * Maps the adjacency index and makes sure it was built from these very data
+ * files before using it.  An index that's missing, truncated, of another
+ * version, older than either data file, otherwise stale or inconsistent
+ * within itself is simply ignored, and the raw records are used instead.
+ */
+bool imdb::attachIndex(const string& directory) {
+	const string fileName = directory + "/" + kIndexFileName;
+	if(!isNewerThanData(fileName, directory + "/" + kActorFileName, directory + "/" + kMovieFileName)) return false;
+	string ignored;
+	if(!acquireFileMap(fileName, indexInfo, policy, ignored)) return false;
+	const indexHeader* header = (const indexHeader*) indexInfo.fileMap;
+	bool valid = indexInfo.fileSize >= sizeof(indexHeader) &&
+		memcmp(header->magic, kIndexMagic, sizeof(kIndexMagic)) == 0 &&
+		header->version == kIndexVersion &&
+		header->actorCount == getActorCount() && header->movieCount == getMovieCount() &&
+		header->actorFileSize == (int) actorInfo.fileSize &&
+		header->movieFileSize == (int) movieInfo.fileSize &&
+		header->creditCount >= 0 && header->castCount >= 0 &&
+		indexInfo.fileSize == sizeof(indexHeader) + sizeof(int) *
+			((size_t) header->actorCount + 1 + header->creditCount + header->movieCount + 1 + header->castCount);
+	if(valid) {
+		creditStart = (const int*) (header + 1);
+		creditMovies = creditStart + header->actorCount + 1;
+		castStart = creditMovies + header->creditCount;
+		castActors = castStart + header->movieCount + 1;
+		valid = isValidAdjacency(creditStart, header->actorCount, creditMovies, header->creditCount,
+				header->movieCount) &&
+			isValidAdjacency(castStart, header->movieCount, castActors, header->castCount,
+				header->actorCount);
+	}
+	if(!valid) {
+		releaseFileMap(indexInfo);
+		creditStart = creditMovies = castStart = castActors = NULL;
+	}
+	return valid;
+}
+
+/**
+ * Maps the landmark file, subject to the same checks as the adjacency index.
+ * A landmark file that doesn't match the data files is ignored.
+ */
+bool imdb::attachLandmarks(const string& directory) {
+	const string fileName = directory + "/" + kLandmarkFileName;
+	if(!isNewerThanData(fileName, directory + "/" + kActorFileName, directory + "/" + kMovieFileName)) return false;
+	string ignored;
+	if(!acquireFileMap(fileName, landmarkInfo, policy, ignored)) return false;
+	const landmarkHeader* header = (const landmarkHeader*) landmarkInfo.fileMap;
+	bool valid = landmarkInfo.fileSize >= sizeof(landmarkHeader) &&
+		memcmp(header->magic, kLandmarkMagic, sizeof(kLandmarkMagic)) == 0 &&
+		header->version == kLandmarkVersion &&
+		header->actorCount == getActorCount() && header->landmarkCount > 0 &&
+		header->actorFileSize == (int) actorInfo.fileSize &&
+		header->movieFileSize == (int) movieInfo.fileSize &&
+		landmarkInfo.fileSize == sizeof(landmarkHeader) + sizeof(int) * (size_t) header->landmarkCount +
+			(size_t) header->landmarkCount * header->actorCount;
+	if(valid) {
+		landmarkCount = header->landmarkCount;
+		landmarkIDs = (const int*) (header + 1);
+		landmarkDistances = (const unsigned char*) (landmarkIDs + landmarkCount);
+		for(int i = 0; i < landmarkCount && valid; i++) {
+			valid = landmarkIDs[i] >= 0 && landmarkIDs[i] < getActorCount();
+		}
+	}
+	if(!valid) {
+		releaseFileMap(landmarkInfo);
+		landmarkCount = 0;
+		landmarkIDs = NULL;
+		landmarkDistances = NULL;
+	}
+	return valid;
+}
+
+static bool writeFully(int fd, const void *data, size_t length) {
+	const char* curr = (const char*) data;
+	while(length > 0) {
+		ssize_t written = write(fd, curr, length);
+		if(written <= 0) return false;
+		curr += written;
+		length -= written;
+	}
+	return true;
+}
+
+bool imdb::buildIndex(const string& fileName) const {
+	if(!good()) return false;
+
+	// flatten the credits and the casts into compressed-sparse-row form
+	int actor_num = getActorCount();
+	int movie_num = getMovieCount();
+	vector<int> credit_start(actor_num + 1), credit_movies;
+	for(int i = 0; i < actor_num; i++) {
+		credit_start[i] = credit_movies.size();
+		idspan credits = getCreditIDs(i);
+		credit_movies.insert(credit_movies.end(), credits.begin(), credits.end());
+	}
+	credit_start[actor_num] = credit_movies.size();
+	vector<int> cast_start(movie_num + 1), cast_actors;
+	for(int i = 0; i < movie_num; i++) {
+		cast_start[i] = cast_actors.size();
+		idspan cast = getCastIDs(i);
+		cast_actors.insert(cast_actors.end(), cast.begin(), cast.end());
+	}
+	cast_start[movie_num] = cast_actors.size();
+
+	indexHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+	header.version = kIndexVersion;
+	header.actorCount = actor_num;
+	header.movieCount = movie_num;
+	header.creditCount = credit_movies.size();
+	header.castCount = cast_actors.size();
+	header.actorFileSize = actorInfo.fileSize;
+	header.movieFileSize = movieInfo.fileSize;
+
+	// write everything to a temporary file, then rename it into place
+	const string tempFileName = fileName + ".tmp";
+	int fd = open(tempFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd == -1) return false;
+	bool success = writeFully(fd, &header, sizeof(header)) &&
+		writeFully(fd, credit_start.data(), credit_start.size() * sizeof(int)) &&
+		writeFully(fd, credit_movies.data(), credit_movies.size() * sizeof(int)) &&
+		writeFully(fd, cast_start.data(), cast_start.size() * sizeof(int)) &&
+		writeFully(fd, cast_actors.data(), cast_actors.size() * sizeof(int));
+	success = (close(fd) == 0) && success;
+	if(success) success = rename(tempFileName.c_str(), fileName.c_str()) == 0;
+	if(!success) unlink(tempFileName.c_str());
+	return success;
+}
+
+bool imdb::buildLandmarks(const string& fileName, const vector<int>& landmarkIDs,
+		const vector<unsigned char>& distances) const {
+	if(!good() || landmarkIDs.empty() ||
+		distances.size() != (size_t) getActorCount() * landmarkIDs.size()) return false;
+
+	landmarkHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, kLandmarkMagic, sizeof(kLandmarkMagic));
+	header.version = kLandmarkVersion;
+	header.actorCount = getActorCount();
+	header.landmarkCount = landmarkIDs.size();
+	header.actorFileSize = actorInfo.fileSize;
+	header.movieFileSize = movieInfo.fileSize;
+
+	// write everything to a temporary file, then rename it into place
+	const string tempFileName = fileName + ".tmp";
+	int fd = open(tempFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd == -1) return false;
+	bool success = writeFully(fd, &header, sizeof(header)) &&
+		writeFully(fd, landmarkIDs.data(), landmarkIDs.size() * sizeof(int)) &&
+		writeFully(fd, distances.data(), distances.size());
+	success = (close(fd) == 0) && success;
+	if(success) success = rename(tempFileName.c_str(), fileName.c_str()) == 0;
+	if(!success) unlink(tempFileName.c_str());
+	return success;
+}
+
+imdbhandle::imdbhandle(const string& directory, bool useIndex, imdb::mappolicy policy, bool nameIndex) :
+	directory(directory), useIndex(useIndex), policy(policy), nameIndex(nameIndex), current(open()) {}
+
+shared_ptr<const imdb> imdbhandle::open() const {
+	shared_ptr<imdb> db = make_shared<imdb>(directory, useIndex, policy);
+	if(db->good() && nameIndex) db->buildNameIndex();
+	return db;
+}
+
+shared_ptr<const imdb> imdbhandle::get() const {
+	return atomic_load(&current);
+}
+
+bool imdbhandle::reload(string& error) {
+	lock_guard<mutex> lg(reloadLock);
+	shared_ptr<const imdb> replacement = open();
+	if(!replacement->good()) {
+		error = replacement->getError();
+		return false;
+	}
+	atomic_store(&current, replacement);
+	return true;
 }
@@ -2,10 +2,112 @@
 #include "imdb-utils.h"
 #include <string>
 #include <vector>
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <mutex>
+
+/**
+ * Convenience struct: idtable
+ * ---------------------------
+ * Translates the byte offset of an actor or movie record (which is what
+ * the records themselves use to refer to each other) back into the dense
+ * ID of that record.  offsets is sorted; ids is NULL when the position
+ * within offsets already is the ID, which is the case whenever the records
+ * are laid out in the same order as the offset table indexing them.
+ */
+struct idtable {
+  const int *offsets;
+  const int *ids;
+  int count;
+
+  int lookup(int offset) const {
+    int pos = std::lower_bound(offsets, offsets + count, offset) - offsets;
+    return ids == NULL ? pos : ids[pos];
+  }
+};
+
+/**
+ * Convenience class: idspan
+ * -------------------------
+ * Read-only view of the actor or movie IDs referenced by a single record.
+ * The span points directly into the memory-mapped data file, so building
+ * one never allocates; each ID is produced from the underlying record
+ * offset as the span is walked.  Spans drawn from the prebuilt adjacency
+ * index (see imdb::buildIndex) have no table, since the index stores the
+ * IDs themselves.
+ */
+class idspan {
+ public:
+  class iterator {
+   public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef int value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const int *pointer;
+    typedef int reference;
+
+    iterator(const int *curr, const idtable *table) : curr(curr), table(table) {}
+    int operator*() const { return table == NULL ? *curr : table->lookup(*curr); }
+    iterator& operator++() { ++curr; return *this; }
+    bool operator==(const iterator& rhs) const { return curr == rhs.curr; }
+    bool operator!=(const iterator& rhs) const { return curr != rhs.curr; }
+   private:
+    const int *curr;
+    const idtable *table;
+  };
+
+  idspan() : first(NULL), last(NULL), table(NULL) {}
+  idspan(const int *first, const int *last, const idtable *table) : first(first), last(last), table(table) {}
+  iterator begin() const { return iterator(first, table); }
+  iterator end() const { return iterator(last, table); }
+  size_t size() const { return last - first; }
+  bool empty() const { return first == last; }
+  int operator[](size_t i) const { return table == NULL ? first[i] : table->lookup(first[i]); }
+
+ private:
+  const int *first;
+  const int *last;
+  const idtable *table;
+};
 
 class imdb {
  public:
-  
+
+/**
+ * Enumeration: mappolicy
+ * ----------------------
+ * How the data files (and any index or landmark file) are brought into
+ * memory.  kMapPlain maps them and leaves the pages to be faulted in as the
+ * first queries happen to touch them.  The others trade a slower (or more
+ * memory-hungry) open for fewer, cheaper faults later:
+ *
+ *     kMapPopulate   maps with MAP_POPULATE, reading every page in up front.
+ *     kMapWillNeed   advises MADV_WILLNEED, starting readahead of the whole
+ *                    file in the background.
+ *     kMapRandom     advises MADV_RANDOM, turning off readahead, which only
+ *                    pays when the page cache is warm and memory is tight.
+ *     kMapHugePages  advises MADV_HUGEPAGE, asking for transparent huge pages
+ *                    where the kernel supports them for file mappings.
+ *     kMapAnonymous  copies each file into private anonymous memory, backed
+ *                    by explicit huge pages if any are reserved and advised
+ *                    to use transparent huge pages otherwise.
+ *
+ * kMapPolicyNames holds the name of each, in order, for command lines.
+ */
+  enum mappolicy { kMapPlain, kMapPopulate, kMapWillNeed, kMapRandom, kMapHugePages, kMapAnonymous };
+  static const int kMapPolicyCount = kMapAnonymous + 1;
+  static const char *const kMapPolicyNames[kMapPolicyCount];
+
+/**
+ * Static Method: parseMapPolicy
+ * -----------------------------
+ * Looks up a mapping policy by name, returning false if there's none by
+ * that name.
+ */
+  static bool parseMapPolicy(const std::string& name, mappolicy& policy);
+
 /**
  * Constructor: imdb
  * -----------------
@@ -15,10 +117,19 @@ class imdb {
  * all of the information about the movies and actors relevant to an IMDB
  * application (like six-degrees).
  *
+ * If the directory also holds an adjacency index built by imdb-index (and that
+ * index matches the data files), getCreditIDs and getCastIDs are served from
+ * it instead of from the raw records.  Likewise, a matching landmark file
+ * built by imdb-landmarks is mapped and made available through the landmark
+ * methods below.  Pass false as the second argument to ignore any index or
+ * landmark file that's present.
+ *
  * @param directory the name of the directory housing the formatted information backing the imdb.
+ * @param useIndex true if a matching adjacency index should be used when present.
+ * @param policy how the files should be brought into memory.
  */
 
-  imdb(const std::string& directory);
+  imdb(const std::string& directory, bool useIndex = true, mappolicy policy = kMapPlain);
 
 /**
  * Predicate Method: good
@@ -29,10 +140,22 @@ class imdb {
  *     1.) either one or both of the data files supporting the imdb were missing
  *     2.) the directory passed to the constructor doesn't exist.
  *     3.) the directory and files all exist, but you don't have the permission to read them.
+ *     4.) a data file is empty, truncated or otherwise inconsistent with its own
+ *         record count, so that reading it would run off the end.
+ *
+ * None of the other methods may be called on an imdb that isn't good.
  */
 
   bool good() const;
 
+/**
+ * Method: getError
+ * ----------------
+ * Explains why good() returns false (naming the file at fault), or returns the
+ * empty string if it doesn't.
+ */
+  const std::string& getError() const;
+
 /**
  * Method: getCredits
  * ------------------
@@ -69,6 +192,233 @@ class imdb {
 
   bool getCast(const film& movie, std::vector<std::string>& players) const;
 
+/**
+ * Methods: forEachCredit
+ *          forEachCast
+ * --------------------
+ * Allocation-free alternatives to getCredits and getCast, for clients that
+ * only need to look at each entry rather than keep it.  forEachCredit calls
+ * visit(title, year) once for each of the actor/actress's credits, and
+ * forEachCast calls visit(name) once for each member of the movie's cast, in
+ * the same order getCredits and getCast would list them.  title and name are
+ * const char *s pointing directly into the memory-mapped file, so they're
+ * valid for as long as the imdb is, and nothing is copied.
+ *
+ * Each may be passed either a name (in which case it returns false without
+ * calling visit if the actor/actress or movie isn't in the database, and true
+ * otherwise) or a valid ID.
+ */
+  template <typename Visitor>
+  bool forEachCredit(const std::string& player, Visitor visit) const {
+    int actorID = getActorID(player);
+    if (actorID == kNoID) return false;
+    forEachCredit(actorID, visit);
+    return true;
+  }
+
+  template <typename Visitor>
+  void forEachCredit(int actorID, Visitor visit) const {
+    short count;
+    const int *offsets = creditOffsets(actorID, count);
+    for (short i = 0; i < count; i++) {
+      const char *title = (const char *) movieFile + offsets[i];
+      visit(title, movieYear(title));
+    }
+  }
+
+  template <typename Visitor>
+  bool forEachCast(const film& movie, Visitor visit) const {
+    int movieID = getMovieID(movie);
+    if (movieID == kNoID) return false;
+    forEachCast(movieID, visit);
+    return true;
+  }
+
+  template <typename Visitor>
+  void forEachCast(int movieID, Visitor visit) const {
+    short count;
+    const int *offsets = castOffsets(movieID, count);
+    for (short i = 0; i < count; i++) {
+      visit((const char *) actorFile + offsets[i]);
+    }
+  }
+
+/**
+ * Constant: kNoID
+ * ---------------
+ * Returned by getActorID and getMovieID when the actor/actress or the movie
+ * isn't in the database.
+ */
+  static const int kNoID = -1;
+
+/**
+ * Methods: getActorCount
+ *          getMovieCount
+ * ----------------------
+ * Returns the number of actors/actresses (or movies) in the database.  Every
+ * actor/actress and every movie is identified by a dense integer ID in the range
+ * [0, count), which is its position in the (sorted) index of the data file.  Actor
+ * IDs are therefore ordered by name, and movie IDs are ordered just as films are.
+ */
+  int getActorCount() const;
+  int getMovieCount() const;
+
+/**
+ * Methods: getActorID
+ *          getMovieID
+ * -------------------
+ * Looks up the ID of the specified actor/actress or movie, returning kNoID
+ * if it isn't in the database.  These are the only lookups by name, so clients
+ * working with IDs need only call them at the endpoints of a query.
+ */
+  int getActorID(const std::string& player) const;
+  int getMovieID(const film& movie) const;
+
+/**
+ * Methods: getActorName
+ *          getMovie
+ * -----------------
+ * Map IDs back to names.  getActorName returns the name as it appears in the
+ * memory-mapped file, so it's valid for as long as the imdb is.  The ID must be
+ * valid.
+ */
+  const char *getActorName(int actorID) const;
+  film getMovie(int movieID) const;
+
+/**
+ * Methods: getCreditIDs
+ *          getCastIDs
+ * -------------------
+ * ID-based equivalents of getCredits and getCast: returns the IDs of the movies
+ * the specified actor/actress appeared in, or of the actors/actresses starring in
+ * the specified movie, in the same order getCredits and getCast would list them.
+ * The returned span references the memory-mapped file directly, so nothing is
+ * allocated or copied.  The ID must be valid.
+ */
+  idspan getCreditIDs(int actorID) const;
+  idspan getCastIDs(int movieID) const;
+
+/**
+ * Constants: kActorFileName
+ *            kMovieFileName
+ * -------------------------
+ * Names of the two data files within the directory passed to the constructor.
+ */
+  static const char *const kActorFileName;
+  static const char *const kMovieFileName;
+
+/**
+ * Struct: dataStamp
+ * Constant: kDataStampMagic
+ * -------------------------
+ * The trailer imdb-build appends to both data files it writes, with the same
+ * generation in each.  Nothing reads past the last record, so a stamped file
+ * is still an ordinary data file, but the constructor refuses a pair whose
+ * generations differ, or where only one file is stamped, since that's an
+ * actor file and a movie file from two different builds.
+ */
+  struct dataStamp {
+    char magic[8];
+    long long generation;
+  };
+  static const char kDataStampMagic[8];
+
+/**
+ * Constant: kIndexFileName
+ * ------------------------
+ * Name of the adjacency index file, which lives alongside the data files.
+ */
+  static const char *const kIndexFileName;
+
+/**
+ * Predicate Method: hasIndex
+ * --------------------------
+ * Returns true if and only if the imdb is serving getCreditIDs and getCastIDs
+ * from an adjacency index.
+ */
+  bool hasIndex() const;
+
+/**
+ * Method: buildIndex
+ * ------------------
+ * Writes the actor-movie graph out as an adjacency index file: a versioned
+ * header followed by, in compressed-sparse-row form, each actor's credits as
+ * movie IDs and each movie's cast as actor IDs, all in the same order the
+ * records list them.  The file is written to a temporary name and renamed
+ * into place, so a reader never sees it half written.
+ *
+ * @param fileName the name of the index file to write.
+ * @return true if and only if the index was written successfully.
+ */
+  bool buildIndex(const std::string& fileName) const;
+
+/**
+ * Constants: kLandmarkFileName
+ *            kNoDistance
+ * ----------------------------
+ * Name of the landmark distance file, which lives alongside the data files,
+ * and the distance it records for actors/actresses a landmark can't reach.
+ */
+  static const char *const kLandmarkFileName;
+  static const unsigned char kNoDistance = 255;
+
+/**
+ * Methods: hasLandmarks
+ *          getLandmarkCount
+ *          getLandmarkID
+ *          getLandmarkDistances
+ * -----------------------------
+ * Access to the landmark distance file written by imdb-landmarks, which the
+ * constructor maps whenever it also uses the adjacency index and finds a
+ * landmark file matching the data files.  The file records the length of the
+ * shortest path from each of a few chosen actors/actresses (the landmarks) to
+ * every actor/actress.  getLandmarkDistances returns, for the specified actor/
+ * actress, getLandmarkCount() distances, one per landmark, pointing directly
+ * into the mapped file.  Distances of kNoDistance mean there's no path.  The
+ * last three may only be called when hasLandmarks() returns true.
+ */
+  bool hasLandmarks() const;
+  int getLandmarkCount() const;
+  int getLandmarkID(int landmark) const;
+  const unsigned char *getLandmarkDistances(int actorID) const;
+
+/**
+ * Method: buildLandmarks
+ * ----------------------
+ * Writes a landmark distance file: a versioned header, the IDs of the
+ * landmarks and then, actor by actor, the distance from each landmark.
+ * Like buildIndex, it writes to a temporary name and renames into place.
+ *
+ * @param fileName the name of the landmark file to write.
+ * @param landmarkIDs the IDs of the landmarks.
+ * @param distances getActorCount() * landmarkIDs.size() distances, laid
+ *                  out as they are to be returned by getLandmarkDistances.
+ * @return true if and only if the file was written successfully.
+ */
+  bool buildLandmarks(const std::string& fileName, const std::vector<int>& landmarkIDs,
+                      const std::vector<unsigned char>& distances) const;
+
+/**
+ * Method: buildNameIndex
+ * ----------------------
+ * Builds in-memory hash tables over the actor names and the movies, after which
+ * getActorID and getMovieID (and with them getCredits and getCast) no longer
+ * binary search the data files but find a name in (expected) constant time.
+ * The tables cost two ints per actor and per movie and take a moment to build,
+ * so they're only worth it to long-lived clients making many lookups.  Without
+ * them, lookups binary search the offset tables, comparing in place against
+ * the mapped records.  Either way, lookups never allocate.  Not safe to call
+ * while other threads are using the imdb.
+ */
+  void buildNameIndex();
+
+/**
+ * Predicate Method: hasNameIndex
+ * ------------------------------
+ * Returns true if and only if buildNameIndex has been called on a good imdb.
+ */
+  bool hasNameIndex() const;
+
 /**
  * Destructor: ~imdb
  * -----------------
@@ -78,8 +428,6 @@ class imdb {
   ~imdb();
   
  private:
-  static const char *const kActorFileName;
-  static const char *const kMovieFileName;
   const void *actorFile;
   const void *movieFile;
   
@@ -88,13 +436,128 @@ class imdb {
   struct fileInfo {
     int fd;
     size_t fileSize;
+    size_t mapSize;
     const void *fileMap;
-  } actorInfo, movieInfo;
+  } actorInfo, movieInfo, indexInfo, landmarkInfo;
+  mappolicy policy;
+  std::string error;
+
+  // the layout of the adjacency index file: the header is followed by
+  // creditStart[actorCount + 1], creditMovies[creditCount],
+  // castStart[movieCount + 1] and castActors[castCount], all ints.
+  struct indexHeader {
+    char magic[8];
+    int version;
+    int actorCount;
+    int movieCount;
+    int creditCount;
+    int castCount;
+    int actorFileSize;
+    int movieFileSize;
+  };
+  static const char kIndexMagic[8];
+  static const int kIndexVersion;
+  const int *creditStart, *creditMovies;
+  const int *castStart, *castActors;
+
+  // the layout of the landmark file: the header is followed by
+  // landmarkIDs[landmarkCount] and then landmarkCount unsigned char
+  // distances for each actor in turn.
+  struct landmarkHeader {
+    char magic[8];
+    int version;
+    int actorCount;
+    int landmarkCount;
+    int actorFileSize;
+    int movieFileSize;
+  };
+  static const char kLandmarkMagic[8];
+  static const int kLandmarkVersion;
+  int landmarkCount;
+  const int *landmarkIDs;
+  const unsigned char *landmarkDistances;
+
+  // offset-to-ID translation tables, and backing storage for the rare data
+  // file whose records aren't laid out in index order
+  idtable actorIDs, movieIDs;
+  std::vector<int> actorIDStorage, movieIDStorage;
+
+  // the optional name index: hash tables of actor and movie IDs
+  std::vector<int> actorSlots, movieSlots;
+
+  const char *actorRecord(int actorID) const;
+  const char *movieRecord(int movieID) const;
+  const int *creditOffsets(int actorID, short& count) const;
+  const int *castOffsets(int movieID, short& count) const;
+  static int movieYear(const char *movieRecord);
   
-  static const void *acquireFileMap(const std::string& fileName, struct fileInfo& info);
+  static bool acquireFileMap(const std::string& fileName, struct fileInfo& info, mappolicy policy,
+                             std::string& error);
   static void releaseFileMap(struct fileInfo& info);
+  static void buildIDTable(const void *file, idtable& table, std::vector<int>& storage);
+  bool attachIndex(const std::string& directory);
+  bool attachLandmarks(const std::string& directory);
 
   imdb(const imdb& original) = delete;
   imdb& operator=(const imdb& rhs) = delete;
   imdb& operator=(const imdb& rhs) const = delete;
 };
+
+/**
+ * Class: imdbhandle
+ * -----------------
+ * A double-buffered reference to an imdb, for long-running clients that
+ * want to pick up new data files without restarting.  get() hands out the
+ * current imdb, and reload() opens the directory afresh and, only if that
+ * succeeds, swaps the new imdb in.  Queries that already hold the old imdb
+ * keep it alive (and its files mapped) until they finish, so a reload never
+ * disturbs a query in flight.  New data files must be renamed into place,
+ * never rewritten, since the old imdb still maps the old files.  A reload
+ * that lands between the two renames sees stamps from two builds and is
+ * refused, so the next one picks up the finished pair.
+ */
+class imdbhandle {
+ public:
+
+/**
+ * Constructor: imdbhandle
+ * -----------------------
+ * Opens the imdb in the specified directory, as the imdb constructor would.
+ * If nameIndex is true, every imdb opened also builds its name index before
+ * it's handed out.
+ */
+  imdbhandle(const std::string& directory, bool useIndex = true,
+             imdb::mappolicy policy = imdb::kMapPlain, bool nameIndex = false);
+
+/**
+ * Method: get
+ * -----------
+ * Returns the current imdb.  Safe to call from any thread, at any time,
+ * including while another thread is reloading.
+ */
+  std::shared_ptr<const imdb> get() const;
+
+/**
+ * Method: reload
+ * --------------
+ * Opens the directory again and swaps the result in if it's good.  If not,
+ * the current imdb stays in place.  Concurrent reloads are serialized.
+ *
+ * @param error updated to explain what went wrong, if anything did.
+ * @return true if and only if a new imdb was swapped in.
+ */
+  bool reload(std::string& error);
+
+ private:
+  std::string directory;
+  bool useIndex;
+  imdb::mappolicy policy;
+  bool nameIndex;
+  std::shared_ptr<const imdb> current;
+  std::mutex reloadLock;
+
+  std::shared_ptr<const imdb> open() const;
+
+  imdbhandle(const imdbhandle& original) = delete;
+  imdbhandle& operator=(const imdbhandle& rhs) = delete;
+};
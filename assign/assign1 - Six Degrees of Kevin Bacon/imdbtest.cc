@@ -1,7 +1,8 @@
 #include <iostream>
 #include <iomanip> // for setw formatter
-#include <map>
-#include <set>
+#include <vector>
+#include <utility>
+#include <algorithm>
 #include <string>
 #include "imdb.h"
 using namespace std;
@@ -23,35 +24,41 @@ static void printFill(const string& noun) {
 /**
  * Function: listMovies
  * --------------------
- * Assumes coming in that the specified actor/actress has appeared in
- * all of the movies populating the specified credits vector.  This routine
- * prints out the first 10 and the last 10 movies, unless there are 20 or fewer
- * movies on the specified actor's/actress's resume (in which case
- * it just prints all of them.)
+ * Lists the movies the specified actor/actress has appeared in.  This
+ * routine prints out the first 10 and the last 10 movies, unless there are
+ * 20 or fewer movies on the specified actor's/actress's resume (in which case
+ * it just prints all of them.)  The titles are visited right where they sit
+ * in the imdb, so none of them is ever copied.
  *
  * @param player the actor/actress of interest.
- * @param credits the specified actor's/actress's list of movie
- *                credits.
+ * @param db the imdb housing the specified player.
+ * @param actorID the specified actor's/actress's ID.
  */
-static void listMovies(const string& player, const vector<film>& credits) {
+static void listMovies(const string& player, const imdb& db, int actorID) {
 	const unsigned int kNumFilmsToPrint = 10;
+	const unsigned int numFilms = db.getCreditIDs(actorID).size();
 	cout << endl;
-	cout << "  " << player << " has starred in " << (int) (credits.size()) << " films, "
+	cout << "  " << player << " has starred in " << (int) numFilms << " films, "
 		<< "and those films are:" << endl << endl;
 	unsigned int numMovies = 0;
-	vector<film>::const_iterator curr;
-	for (curr = credits.begin(); curr != credits.end() && numMovies < kNumFilmsToPrint; ++curr) {
-		const film& movie = *curr;
-		cout << setw(5) << ++numMovies << ".) " << movie.title << " (" << movie.year << ")" << endl;
-	}
-	if (curr != credits.end()) {
-		if (credits.size() > 2 * kNumFilmsToPrint) printFill("films");
-		while (numMovies < (credits.size() - kNumFilmsToPrint)) { numMovies++; ++curr; }
-		for (;curr != credits.end(); ++curr) {
-			const film& movie = *curr;
-			cout << setw(5) << ++numMovies << ".) " << movie.title << " (" << movie.year << ")" << endl;      
+	db.forEachCredit(actorID, [&](const char *title, int year) {
+		numMovies++;
+		if (numMovies == kNumFilmsToPrint + 1 && numFilms > 2 * kNumFilmsToPrint) printFill("films");
+		if (numMovies <= kNumFilmsToPrint || numMovies + kNumFilmsToPrint > numFilms) {
+			cout << setw(5) << numMovies << ".) " << title << " (" << year << ")" << endl;
 		}
-	}
+	});
+}
+
+/**
+ * Function: printCostar
+ * ---------------------
+ * Prints one line of the costar listing.
+ */
+static void printCostar(const imdb& db, unsigned int rank, const pair<int, int>& costar) {
+	cout << setw(5) << rank << ".) " << db.getActorName(costar.first);
+	if (costar.second > 1) cout << " (in " << costar.second << " different films)";
+	cout << endl;
 }
 
 /**
@@ -59,30 +66,34 @@ static void listMovies(const string& player, const vector<film>& credits) {
  * ---------------------
  * Builds up the list of costars and then prints all these
  * costars in a format similar to that used by listMovies.
- * The STL set is used to collect actor/actress names without
- * storing duplicates.
+ * Every (costar, film) pairing is collected by ID and then sorted,
+ * which discards duplicates and, since actor IDs are ordered by
+ * name, leaves the costars in alphabetical order.
  *
  * @param player the actor/actress of interest.
- * @param credits the list of movies that the specified actor/actress has appeared in.
- *                (No integrity checks are done, so it's the client's responsibility to make sure
- *                 the specified actor/actress really has appeared in these movies.)
- * @param db the imdb housing the specified plater, list of movies, etc.  This is passed in
- *           so that each member of each cast of each movie can be added to the specified player's
- *           set of costars.
+ * @param db the imdb housing the specified player.
+ * @param actorID the specified actor's/actress's ID.
  */
-static void listCostars(const string &player, const vector<film>& credits, const imdb& db) {
+static void listCostars(const string &player, const imdb& db, int actorID) {
 	const unsigned int kNumCostarsToPrint = 10;
-	map<string, set<film>> costars;
-	for (int i = 0; i < (int) credits.size(); i++) {
-		const film& movie = credits[i];
-		vector<string> cast;
-		db.getCast(movie, cast);
-		for (int j = 0; j < (int) cast.size(); j++) {
-			const string& costar = cast[j];
-			if (costar != player) {
-				costars[costar].insert(movie);
-			}
+	vector<pair<int, int>> pairings;
+	idspan credits = db.getCreditIDs(actorID);
+	for (idspan::iterator movie = credits.begin(); movie != credits.end(); ++movie) {
+		idspan cast = db.getCastIDs(*movie);
+		for (idspan::iterator costar = cast.begin(); costar != cast.end(); ++costar) {
+			if (*costar != actorID) pairings.push_back(make_pair(*costar, *movie));
+		}
+	}
+	sort(pairings.begin(), pairings.end());
+	pairings.erase(unique(pairings.begin(), pairings.end()), pairings.end());
+
+	// each costar, along with the number of different films shared
+	vector<pair<int, int>> costars;
+	for (unsigned int i = 0; i < pairings.size(); i++) {
+		if (costars.empty() || costars.back().first != pairings[i].first) {
+			costars.push_back(make_pair(pairings[i].first, 0));
 		}
+		costars.back().second++;
 	}
 
 	cout << endl;
@@ -90,22 +101,15 @@ static void listCostars(const string &player, const vector<film>& credits, const
 		<< "and those other people are:" << endl << endl;
 
 	unsigned int numCostars = 0;
-	map<string, set<film>>::const_iterator curr;
-	for (curr = costars.begin(); curr != costars.end() && numCostars < kNumCostarsToPrint; ++curr) {
-		const string& costar = curr->first;
-		cout << setw(5) << ++numCostars << ".) " << costar;
-		if (curr->second.size() > 1) cout << " (in " << (int) curr->second.size() << " different films)";
-		cout << endl;
+	for (; numCostars < costars.size() && numCostars < kNumCostarsToPrint; numCostars++) {
+		printCostar(db, numCostars + 1, costars[numCostars]);
 	}
 
-	if (curr != costars.end()) {
+	if (numCostars < costars.size()) {
 		if (costars.size() > 2 * kNumCostarsToPrint) printFill("people");
-		while (numCostars < costars.size() - kNumCostarsToPrint) { numCostars++; ++curr; }
-		for (; curr != costars.end(); ++curr) {
-			const string& costar = curr->first;
-			cout << setw(5) << ++numCostars << ".) " << costar;
-			if (curr->second.size() > 1) cout << " (in " << (int) curr->second.size() << " different films)";
-			cout << endl;
+		numCostars = max<size_t>(numCostars, costars.size() - kNumCostarsToPrint);
+		for (; numCostars < costars.size(); numCostars++) {
+			printCostar(db, numCostars + 1, costars[numCostars]);
 		}
 	}
 
@@ -120,8 +124,7 @@ static void listCostars(const string &player, const vector<film>& credits, const
  * appeared in a non-zero number of films.)  If the specified
  * actor/actress is missing (or if there are no films to speak
  * of), then a polite message is printed and we return immediately.
- * Otherwise, we assume that the local vector<film> has been populated
- * with real data, and we pass the buck onto the listMovies and the
+ * Otherwise, we pass the buck onto the listMovies and the
  * listCostars routines.  See the documentation for each of those functions
  * on what they do and how they work.
  *
@@ -132,15 +135,15 @@ static void listCostars(const string &player, const vector<film>& credits, const
  *           good test.
  */
 static void listAllMoviesAndCostars(const imdb& db, const string& player) {
-	vector<film> credits;
-	if (!db.getCredits(player, credits) || credits.size() == 0) {
+	int actorID = db.getActorID(player);
+	if (actorID == imdb::kNoID || db.getCreditIDs(actorID).empty()) {
 		cout << "We're sorry, but " << player 
 			<< " doesn't appear to be in our database." << endl;
 		return;
 	}
 
-	listMovies(player, credits);
-	listCostars(player, credits, db);
+	listMovies(player, db, actorID);
+	listCostars(player, db, actorID);
 }
 
 int main(int argc, const char *argv[]) {
@@ -151,7 +154,7 @@ int main(int argc, const char *argv[]) {
 
 	imdb db(kIMDBDataDirectory);
 	if (!db.good()) {
-		cerr << "Data directory not found!  Aborting..." << endl; 
+		cerr << db.getError() << "!  Aborting..." << endl; 
 		return kDatabaseNotFound;
 	}
 
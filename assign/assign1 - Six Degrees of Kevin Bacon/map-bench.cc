@@ -0,0 +1,180 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "imdb.h"
+#include "path.h"
+#include "search-engine.h"
+using namespace std;
+
+static const int kWrongArgumentCount = 1;
+static const int kPairsFileNotFound = 3;
+static const int kRunFailed = 4;
+
+/**
+ * The fixed workload, as in search-bench: the pairs exercised by the
+ * sanity check.
+ */
+static const char *const kDefaultPairs[][2] = {
+	{"Meryl Streep", "Jack Nicholson (I)"},
+	{"Mary Tyler Moore", "Red Buttons"},
+	{"Jerry Cain", "Kevin Bleyer"},
+	{"Ewan McGregor", "Dustin Hoffman"}
+};
+
+/**
+ * Convenience struct: startup
+ * ---------------------------
+ * Everything recorded about a single start: how long the imdb took to open,
+ * how long the first query and all of the queries took, and how many page
+ * faults (major ones needing disk reads, and minor ones) were taken.
+ */
+struct startup {
+	double openMillis;
+	double firstMillis;
+	double totalMillis;
+	long majorFaults;
+	long minorFaults;
+};
+
+/**
+ * Function: dropCache
+ * -------------------
+ * Asks the kernel to evict every file the imdb might map from the page
+ * cache, so that the next start is cold.  Only clean pages that nobody has
+ * mapped can go, which is why the benchmark itself never maps them.
+ */
+static void dropCache(const string& directory) {
+	const char *const fileNames[] = {
+		imdb::kActorFileName, imdb::kMovieFileName, imdb::kIndexFileName, imdb::kLandmarkFileName
+	};
+	for (size_t i = 0; i < sizeof(fileNames) / sizeof(fileNames[0]); i++) {
+		int fd = open((directory + "/" + fileNames[i]).c_str(), O_RDONLY);
+		if (fd == -1) continue;
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+}
+
+/**
+ * Function: measureStartup
+ * ------------------------
+ * Opens the imdb under the specified policy in a forked child and runs
+ * the queries with the plain breadth-first search, which touches the most
+ * of the files, then reports back over a pipe.
+ */
+static bool measureStartup(const string& directory, imdb::mappolicy policy,
+		const vector<pair<string, string>>& pairs, startup& s) {
+	int fds[2];
+	if (pipe(fds) == -1) return false;
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(fds[0]);
+		startup result;
+		struct rusage before, after;
+		getrusage(RUSAGE_SELF, &before);
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		imdb db(directory, true, policy);
+		chrono::steady_clock::time_point opened = chrono::steady_clock::now();
+		if (!db.good()) _exit(1);
+		result.firstMillis = 0;
+		for (size_t i = 0; i < pairs.size(); i++) {
+			path p(pairs[i].first);
+			findShortestPath(db, pairs[i].first, pairs[i].second, p);
+			if (i == 0) result.firstMillis = chrono::duration<double, milli>(chrono::steady_clock::now() - opened).count();
+		}
+		chrono::steady_clock::time_point finished = chrono::steady_clock::now();
+		getrusage(RUSAGE_SELF, &after);
+		result.openMillis = chrono::duration<double, milli>(opened - start).count();
+		result.totalMillis = chrono::duration<double, milli>(finished - opened).count();
+		result.majorFaults = after.ru_majflt - before.ru_majflt;
+		result.minorFaults = after.ru_minflt - before.ru_minflt;
+		_exit(write(fds[1], &result, sizeof(result)) == sizeof(result) ? 0 : 1);
+	}
+	close(fds[1]);
+	bool success = pid != -1 && read(fds[0], &s, sizeof(s)) == sizeof(s);
+	close(fds[0]);
+	if (pid != -1) waitpid(pid, NULL, 0);
+	return success;
+}
+
+/**
+ * Function: readPairs
+ * -------------------
+ * Reads newline-delimited source/target pairs, separated by a tab, from
+ * the named file.  Lines without a tab are skipped.
+ */
+static bool readPairs(const string& fileName, vector<pair<string, string>>& pairs) {
+	ifstream infile(fileName.c_str());
+	if (!infile) return false;
+	string line;
+	while (getline(infile, line)) {
+		size_t tab = line.find('\t');
+		if (tab == string::npos) continue;
+		pairs.push_back(make_pair(line.substr(0, tab), line.substr(tab + 1)));
+	}
+	return true;
+}
+
+static void printUsage(const char *progname) {
+	cerr << "Usage: " << progname << " [-d data-directory] [-f pairs-file]" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	string directory = kIMDBDataDirectory;
+	string pairsFile;
+	int opt;
+	while ((opt = getopt(argc, argv, "d:f:")) != -1) {
+		switch (opt) {
+		case 'd':
+			directory = optarg;
+			break;
+		case 'f':
+			pairsFile = optarg;
+			break;
+		default:
+			printUsage(argv[0]);
+			return kWrongArgumentCount;
+		}
+	}
+	if (optind != argc) {
+		printUsage(argv[0]);
+		return kWrongArgumentCount;
+	}
+
+	vector<pair<string, string>> pairs;
+	if (pairsFile.empty()) {
+		for (size_t i = 0; i < sizeof(kDefaultPairs) / sizeof(kDefaultPairs[0]); i++)
+			pairs.push_back(make_pair(kDefaultPairs[i][0], kDefaultPairs[i][1]));
+	} else if (!readPairs(pairsFile, pairs)) {
+		cerr << "Pairs file \"" << pairsFile << "\" not found!  Aborting..." << endl;
+		return kPairsFileNotFound;
+	}
+
+	cout << left << setw(12) << "policy" << setw(7) << "cache" << right << setw(12) << "open ms"
+		<< setw(12) << "first ms" << setw(12) << "all ms" << setw(12) << "major" << setw(12) << "minor" << endl;
+	for (int i = 0; i < imdb::kMapPolicyCount; i++) {
+		imdb::mappolicy policy = (imdb::mappolicy) i;
+		for (int warm = 0; warm <= 1; warm++) {
+			if (!warm) dropCache(directory);
+			startup s;
+			if (!measureStartup(directory, policy, pairs, s)) {
+				cerr << "Couldn't open the imdb in \"" << directory << "\" with the "
+					<< imdb::kMapPolicyNames[i] << " policy!  Aborting..." << endl;
+				return kRunFailed;
+			}
+			cout << left << setw(12) << imdb::kMapPolicyNames[i] << setw(7) << (warm ? "warm" : "cold")
+				<< right << fixed << setprecision(2) << setw(12) << s.openMillis << setw(12) << s.firstMillis
+				<< setw(12) << s.totalMillis << setw(12) << s.majorFaults << setw(12) << s.minorFaults << endl;
+		}
+	}
+	return 0;
+}
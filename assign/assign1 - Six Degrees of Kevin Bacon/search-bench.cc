@@ -0,0 +1,246 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <cstdlib>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "imdb.h"
+#include "path.h"
+#include "search-engine.h"
+using namespace std;
+
+static const int kWrongArgumentCount = 1;
+static const int kDatabaseNotFound = 2;
+static const int kPairsFileNotFound = 3;
+static const int kLengthMismatch = 4;
+static const int kPathMismatch = 5;
+
+/**
+ * The fixed workload: the pairs exercised by the sanity check plus a few
+ * well-connected ones, where the single-ended search hurts the most.
+ */
+static const char *const kDefaultPairs[][2] = {
+	{"Meryl Streep", "Jack Nicholson (I)"},
+	{"Jack Nicholson (I)", "Meryl Streep"},
+	{"Mary Tyler Moore", "Red Buttons"},
+	{"Jerry Cain", "Kevin Bleyer"},
+	{"Ewan McGregor", "Dustin Hoffman"},
+	{"Red Buttons", "Jerry Cain"},
+	{"Meryl Streep", "Kevin Bleyer"},
+	{"Kevin Bacon (I)", "Jerry Cain"}
+};
+
+typedef function<bool(const imdb& db, const string& source, const string& target,
+		path& result, searchstats *stats)> searchfn;
+
+/**
+ * An engine is a named search routine.  Engines that promise the very path
+ * the serial bfs finds (rather than just one of the same length) are checked
+ * against it.
+ */
+struct engine {
+	string name;
+	searchfn search;
+	bool samePath;
+};
+
+/**
+ * Builds the list of engines to compare: the serial bfs always comes first,
+ * and when maxThreads is positive, the parallel search follows the
+ * bidirectional one once for every thread count from 1 through maxThreads.
+ */
+static vector<engine> buildEngines(size_t maxThreads) {
+	vector<engine> engines;
+	bool (*bfs)(const imdb&, const string&, const string&, path&, searchstats *) = findShortestPath;
+	bool (*bidirectional)(const imdb&, const string&, const string&, path&, searchstats *) =
+		findShortestPathBidirectional;
+	engines.push_back(engine{"bfs", bfs, true});
+	engines.push_back(engine{"bidirectional", bidirectional, false});
+	for (size_t threads = 1; threads <= maxThreads; threads++) {
+		ostringstream name;
+		name << "parallel/" << threads;
+		engines.push_back(engine{name.str(), [threads](const imdb& db, const string& source, const string& target,
+				path& result, searchstats *stats) {
+			return findShortestPathParallel(db, source, target, result, threads, stats);
+		}, true});
+	}
+	return engines;
+}
+
+/**
+ * Convenience struct: measurement
+ * -------------------------------
+ * Everything recorded about a single query run by a single engine.
+ */
+struct measurement {
+	int length;
+	size_t pathHash;
+	searchstats stats;
+	double millis;
+	long peakKB;
+};
+
+/**
+ * Function: measure
+ * -----------------
+ * Runs one query in a forked child, so that no engine inherits a heap
+ * left fragmented by an earlier one, and reports the result back over a pipe.
+ * The memory-mapped data files are shared with the child, so the query
+ * still runs against a warm page cache.  The child also reports how far the
+ * query raised its resident set's high-water mark.
+ */
+static bool measure(const imdb& db, const engine& e, const pair<string, string>& query, measurement& m) {
+	int fds[2];
+	if (pipe(fds) == -1) return false;
+	pid_t pid = fork();
+	if (pid == 0) {
+		close(fds[0]);
+		path p(query.first);
+		measurement result;
+		struct rusage before, after;
+		getrusage(RUSAGE_SELF, &before);
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		bool found = e.search(db, query.first, query.second, p, &result.stats);
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		getrusage(RUSAGE_SELF, &after);
+		result.peakKB = after.ru_maxrss - before.ru_maxrss;
+		result.length = found ? (int) p.getLength() : -1;
+		ostringstream text;
+		text << p;
+		result.pathHash = found ? hash<string>()(text.str()) : 0;
+		result.millis = elapsed.count();
+		_exit(write(fds[1], &result, sizeof(result)) == sizeof(result) ? 0 : 1);
+	}
+	close(fds[1]);
+	bool success = pid != -1 && read(fds[0], &m, sizeof(m)) == sizeof(m);
+	close(fds[0]);
+	if (pid != -1) waitpid(pid, NULL, 0);
+	return success;
+}
+
+/**
+ * Function: readPairs
+ * -------------------
+ * Reads newline-delimited source/target pairs, separated by a tab, from
+ * the named file.  Lines without a tab are skipped.
+ */
+static bool readPairs(const string& fileName, vector<pair<string, string>>& pairs) {
+	ifstream infile(fileName.c_str());
+	if (!infile) return false;
+	string line;
+	while (getline(infile, line)) {
+		size_t tab = line.find('\t');
+		if (tab == string::npos) continue;
+		pairs.push_back(make_pair(line.substr(0, tab), line.substr(tab + 1)));
+	}
+	return true;
+}
+
+static void printUsage(const char *progname) {
+	cerr << "Usage: " << progname << " [-d data-directory] [-f pairs-file] [-t max-threads]" << endl;
+}
+
+int main(int argc, char *argv[]) {
+	string directory = kIMDBDataDirectory;
+	string pairsFile;
+	int maxThreads = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "d:f:t:")) != -1) {
+		switch (opt) {
+		case 'd':
+			directory = optarg;
+			break;
+		case 'f':
+			pairsFile = optarg;
+			break;
+		case 't':
+			maxThreads = atoi(optarg);
+			break;
+		default:
+			printUsage(argv[0]);
+			return kWrongArgumentCount;
+		}
+	}
+	if (optind != argc || maxThreads < 0) {
+		printUsage(argv[0]);
+		return kWrongArgumentCount;
+	}
+
+	imdb db(directory);
+	if (!db.good()) {
+		cerr << db.getError() << "!  Aborting..." << endl;
+		return kDatabaseNotFound;
+	}
+
+	vector<pair<string, string>> pairs;
+	if (pairsFile.empty()) {
+		for (size_t i = 0; i < sizeof(kDefaultPairs) / sizeof(kDefaultPairs[0]); i++)
+			pairs.push_back(make_pair(kDefaultPairs[i][0], kDefaultPairs[i][1]));
+	} else if (!readPairs(pairsFile, pairs)) {
+		cerr << "Pairs file \"" << pairsFile << "\" not found!  Aborting..." << endl;
+		return kPairsFileNotFound;
+	}
+
+	vector<engine> engines = buildEngines(maxThreads);
+	const size_t numEngines = engines.size();
+	vector<searchstats> totals(numEngines);
+	vector<double> totalMillis(numEngines, 0.0);
+	vector<long> maxPeakKB(numEngines, 0);
+	int mismatches = 0;
+	int pathMismatches = 0;
+	cout << left << setw(16) << "engine" << right << setw(8) << "length" << setw(12) << "actors"
+		<< setw(12) << "movies" << setw(12) << "ms" << setw(12) << "peak KB" << "  query" << endl;
+	for (size_t i = 0; i < pairs.size(); i++) {
+		int expectedLength = -1;
+		size_t expectedHash = 0;
+		for (size_t e = 0; e < numEngines; e++) {
+			measurement m;
+			if (!measure(db, engines[e], pairs[i], m)) {
+				cerr << "Failed to run " << engines[e].name << " on " << pairs[i].first
+					<< " -> " << pairs[i].second << endl;
+				continue;
+			}
+			if (e == 0) {
+				expectedLength = m.length;
+				expectedHash = m.pathHash;
+			} else if (m.length != expectedLength) {
+				mismatches++;
+			} else if (engines[e].samePath && m.pathHash != expectedHash) {
+				pathMismatches++;
+			}
+			totals[e].actorsExpanded += m.stats.actorsExpanded;
+			totals[e].moviesExpanded += m.stats.moviesExpanded;
+			totalMillis[e] += m.millis;
+			maxPeakKB[e] = max(maxPeakKB[e], m.peakKB);
+			cout << left << setw(16) << engines[e].name << right << setw(8) << m.length
+				<< setw(12) << m.stats.actorsExpanded << setw(12) << m.stats.moviesExpanded
+				<< setw(12) << fixed << setprecision(2) << m.millis << setw(12) << m.peakKB
+				<< "  " << pairs[i].first << " -> " << pairs[i].second << endl;
+		}
+	}
+
+	cout << endl;
+	for (size_t e = 0; e < numEngines; e++) {
+		cout << left << setw(16) << engines[e].name << right << setw(8) << "total"
+			<< setw(12) << totals[e].actorsExpanded << setw(12) << totals[e].moviesExpanded
+			<< setw(12) << fixed << setprecision(2) << totalMillis[e] << setw(12) << maxPeakKB[e] << endl;
+	}
+	if (mismatches > 0) {
+		cerr << mismatches << " queries disagreed on the shortest path length!" << endl;
+		return kLengthMismatch;
+	}
+	if (pathMismatches > 0) {
+		cerr << pathMismatches << " queries found a different path than the serial bfs!" << endl;
+		return kPathMismatch;
+	}
+	return 0;
+}
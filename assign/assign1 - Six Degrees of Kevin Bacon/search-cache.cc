@@ -0,0 +1,154 @@
+#include "search-cache.h"
+#include <iomanip>
+using namespace std;
+
+/**
+ * A source becomes hot, and gets a tree, on its kHotSourceQueries-th query.
+ * Query counts are kept for at most kMaxTrackedSources sources; past that,
+ * every count is halved and those reaching zero are forgotten, so only
+ * sources that stay popular ever get there.  kEntryOverhead approximates
+ * the bookkeeping (list node, hash table entry) behind every entry.
+ */
+static const int kHotSourceQueries = 4;
+static const size_t kMaxTrackedSources = 4096;
+static const size_t kEntryOverhead = 96;
+
+static uint64_t makeKey(int sourceID, int targetID) {
+	return ((uint64_t) (uint32_t) sourceID << 32) | (uint32_t) targetID;
+}
+
+querycache::querycache(size_t memoryBudget) :
+	memoryBudget(memoryBudget), answerBytes(0), treeBytes(0), answerHits(0), answerMisses(0),
+	treeHits(0), treesBuilt(0), evictions(0), invalidations(0) {}
+
+/**
+ * Empties the cache if its entries belong to some imdb other than db, and
+ * takes db as the owner of everything cached from now on.  Called with the
+ * lock held.
+ */
+void querycache::adopt(const shared_ptr<const imdb>& db) {
+	if(owner == db) return;
+	if(owner != NULL) invalidations++;
+	owner = db;
+	answers.clear();
+	answerIndex.clear();
+	answerBytes = 0;
+	trees.clear();
+	treeIndex.clear();
+	sourceCounts.clear();
+	treeBytes = 0;
+}
+
+bool querycache::findAnswer(const shared_ptr<const imdb>& db, int sourceID, int targetID, string& text) {
+	lock_guard<mutex> lg(lock);
+	adopt(db);
+	unordered_map<uint64_t, list<answer>::iterator>::iterator found = answerIndex.find(makeKey(sourceID, targetID));
+	if(found == answerIndex.end()) {
+		answerMisses++;
+		return false;
+	}
+	answers.splice(answers.begin(), answers, found->second);
+	text = found->second->text;
+	answerHits++;
+	return true;
+}
+
+void querycache::storeAnswer(const shared_ptr<const imdb>& db, int sourceID, int targetID, const string& text) {
+	lock_guard<mutex> lg(lock);
+	adopt(db);
+	uint64_t key = makeKey(sourceID, targetID);
+	size_t bytes = text.size() + kEntryOverhead;
+	if(answerIndex.count(key) > 0 || bytes > memoryBudget - treeBytes) return;
+	answer a = { key, text };
+	answers.push_front(a);
+	answerIndex[key] = answers.begin();
+	answerBytes += bytes;
+	evictAnswers();
+}
+
+/**
+ * Evicts the least recently used answers until the answers fit in whatever
+ * the trees leave of the budget.  Called with the lock held.
+ */
+void querycache::evictAnswers() {
+	while(!answers.empty() && answerBytes > memoryBudget - treeBytes) {
+		answerBytes -= answers.back().text.size() + kEntryOverhead;
+		answerIndex.erase(answers.back().key);
+		answers.pop_back();
+		evictions++;
+	}
+}
+
+/**
+ * Counts another query from the source and reports whether that makes it
+ * hot.  Called with the lock held.
+ */
+bool querycache::isHot(int sourceID) {
+	if(++sourceCounts[sourceID] >= kHotSourceQueries) return true;
+	if(sourceCounts.size() > kMaxTrackedSources) {
+		for(unordered_map<int, int>::iterator it = sourceCounts.begin(); it != sourceCounts.end(); ) {
+			it->second /= 2;
+			if(it->second == 0) it = sourceCounts.erase(it);
+			else ++it;
+		}
+	}
+	return false;
+}
+
+/**
+ * Evicts the least recently used trees until one more of the specified size
+ * fits in half the budget, returning false if it never will.  Called with
+ * the lock held.
+ */
+bool querycache::makeRoomForTree(size_t bytes) {
+	if(bytes > memoryBudget / 2) return false;
+	while(treeBytes + bytes > memoryBudget / 2) {
+		treeBytes -= trees.back().bytes;
+		treeIndex.erase(trees.back().sourceID);
+		trees.pop_back();
+		evictions++;
+	}
+	return true;
+}
+
+shared_ptr<const searchtree> querycache::findTree(const shared_ptr<const imdb>& db, int sourceID) {
+	size_t bytes = 2 * sizeof(int) * db->getActorCount() + kEntryOverhead;
+	{
+		lock_guard<mutex> lg(lock);
+		adopt(db);
+		unordered_map<int, list<tree>::iterator>::iterator found = treeIndex.find(sourceID);
+		if(found != treeIndex.end()) {
+			trees.splice(trees.begin(), trees, found->second);
+			treeHits++;
+			return found->second->links;
+		}
+		if(bytes > memoryBudget / 2 || !isHot(sourceID) || building.count(sourceID) > 0) return NULL;
+		building.insert(sourceID);
+	}
+
+	// build the tree without holding the lock, so other queries carry on
+	shared_ptr<searchtree> links = make_shared<searchtree>();
+	buildSearchTree(*db, sourceID, *links);
+	lock_guard<mutex> lg(lock);
+	building.erase(sourceID);
+	if(owner != db || !makeRoomForTree(bytes)) return links;
+	tree t = { sourceID, bytes, links };
+	trees.push_front(t);
+	treeIndex[sourceID] = trees.begin();
+	treeBytes += bytes;
+	sourceCounts.erase(sourceID);
+	treesBuilt++;
+	evictAnswers();
+	return links;
+}
+
+void querycache::printStats(ostream& os) const {
+	lock_guard<mutex> lg(lock);
+	size_t lookups = answerHits + answerMisses;
+	os << "Cache: " << answerHits << " of " << lookups << " queries answered from cached answers";
+	if(lookups > 0) os << " (" << fixed << setprecision(1) << 100.0 * answerHits / lookups << "%)";
+	os << ", " << treeHits << " more from cached trees" << endl;
+	os << "       " << treesBuilt << " trees built, " << evictions << " evictions, " << invalidations
+		<< " invalidations, " << (answerBytes + treeBytes) / 1024 << " of " << memoryBudget / 1024
+		<< " KB in use (" << answers.size() << " answers, " << trees.size() << " trees)" << endl;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include "imdb.h"
+#include "search-engine.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <mutex>
+#include <iostream>
+
+/**
+ * Class: querycache
+ * -----------------
+ * Remembers recent answers for a long-running server, where a few popular
+ * actors/actresses account for most of the queries.  Two kinds of entry
+ * share one memory budget:
+ *
+ *     answers  the text of recent answers, keyed by source and target ID and
+ *              evicted least recently used first.
+ *     trees    the complete searchtree of each source queried often enough
+ *              to be considered hot, from which a query to any target can be
+ *              answered without searching.  Trees may take up at most half of
+ *              the budget, and are also evicted least recently used first.
+ *
+ * Every entry belongs to the imdb it was computed against.  The cache holds on
+ * to that imdb, and the first lookup against a different one (after a reload,
+ * say) empties the cache.  Safe to use from any number of threads.
+ */
+class querycache {
+ public:
+
+  /**
+   * Constructor: querycache
+   * -----------------------
+   * Constructs an empty cache that will hold at most memoryBudget bytes of
+   * answers and trees.
+   */
+  querycache(size_t memoryBudget);
+
+  /**
+   * Methods: findAnswer
+   *          storeAnswer
+   * --------------------
+   * Look up and remember the answer to the query from source to target.
+   * findAnswer returns false (and counts a miss) if there's no answer cached.
+   */
+  bool findAnswer(const std::shared_ptr<const imdb>& db, int sourceID, int targetID, std::string& text);
+  void storeAnswer(const std::shared_ptr<const imdb>& db, int sourceID, int targetID,
+                   const std::string& text);
+
+  /**
+   * Method: findTree
+   * ----------------
+   * Notes another query from the specified source and returns its tree if
+   * one is cached.  The query that makes a source hot builds the source's
+   * tree on the calling thread, caches it and returns it.  Returns NULL if
+   * the source isn't (yet) hot, or its tree doesn't fit.
+   */
+  std::shared_ptr<const searchtree> findTree(const std::shared_ptr<const imdb>& db, int sourceID);
+
+  /**
+   * Method: printStats
+   * ------------------
+   * Prints the hit rates of the answers and the trees, and how much of the
+   * budget is in use.
+   */
+  void printStats(std::ostream& os) const;
+
+ private:
+  struct answer {
+    uint64_t key;
+    std::string text;
+  };
+  struct tree {
+    int sourceID;
+    size_t bytes;
+    std::shared_ptr<const searchtree> links;
+  };
+
+  size_t memoryBudget;
+  mutable std::mutex lock;
+  std::shared_ptr<const imdb> owner;
+
+  std::list<answer> answers;  // most recently used first
+  std::unordered_map<uint64_t, std::list<answer>::iterator> answerIndex;
+  size_t answerBytes;
+
+  std::list<tree> trees;  // most recently used first
+  std::unordered_map<int, std::list<tree>::iterator> treeIndex;
+  std::unordered_map<int, int> sourceCounts;
+  std::unordered_set<int> building;
+  size_t treeBytes;
+
+  size_t answerHits, answerMisses;
+  size_t treeHits, treesBuilt;
+  size_t evictions, invalidations;
+
+  void adopt(const std::shared_ptr<const imdb>& db);
+  void evictAnswers();
+  bool makeRoomForTree(size_t bytes);
+  bool isHot(int sourceID);
+
+  querycache(const querycache& original) = delete;
+  querycache& operator=(const querycache& rhs) = delete;
+};
@@ -0,0 +1,434 @@
+#include "search-engine.h"
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <vector>
+using namespace std;
+
+/**
+ * Sizes the side to the database the first time it's used with it (or
+ * again whenever the database changes, say after a reload), clears whatever
+ * the previous query left behind, and then seeds it with the root actor.
+ * The sizes are checked as well as the imdb's address, since a reloaded imdb
+ * may well be allocated where the old one was.
+ */
+void searchscratch::side::prepare(const imdb& db, int root) {
+	if(preparedFor != &db || reached.size() != (size_t) db.getActorCount() ||
+			visitedMovie.size() != (size_t) db.getMovieCount()) {
+		preparedFor = &db;
+		reached.assign(db.getActorCount(), false);
+		parentActor.assign(db.getActorCount(), imdb::kNoID);
+		parentMovie.assign(db.getActorCount(), imdb::kNoID);
+		visitedMovie.assign(db.getMovieCount(), false);
+		touchedActors.clear();
+		touchedMovies.clear();
+	}
+	for(unsigned i = 0; i < touchedActors.size(); i++) reached[touchedActors[i]] = false;
+	for(unsigned i = 0; i < touchedMovies.size(); i++) visitedMovie[touchedMovies[i]] = false;
+	touchedActors.clear();
+	touchedMovies.clear();
+	current.clear();
+	depth = 0;
+	reach(root, imdb::kNoID, imdb::kNoID);
+	current.push_back(root);
+}
+
+/**
+ * Appends the connection leading to the specified actor, by way of the
+ * specified movie, onto the path.
+ */
+static void addConnection(const imdb& db, path& result, int movie_id, int actor_id) {
+	result.addConnection(db.getMovie(movie_id), db.getActorName(actor_id));
+}
+
+bool findShortestPath(const imdb& db, const string& source, const string& target,
+		path& result, searchstats *stats) {
+	searchscratch scratch;
+	return findShortestPath(db, source, target, result, scratch, stats);
+}
+
+bool findShortestPath(const imdb& db, const string& source, const string& target,
+		path& result, searchscratch& scratch, searchstats *stats) {
+	if(source == target) {
+		result = path(source);
+		return true;
+	}
+	int source_id = db.getActorID(source);
+	int target_id = db.getActorID(target);
+	if(source_id == imdb::kNoID || target_id == imdb::kNoID) return false;
+
+	// the queue holds only actor IDs; how each was reached lives in the parent links
+	searchscratch::side& visited = scratch.forward;
+	visited.prepare(db, source_id);
+	vector<int>& todo = visited.current;
+
+	// an actor's parent links are fixed the moment it's first discovered,
+	// so the search can stop as soon as the target is
+	bool found = false;
+	for(size_t head = 0; head < todo.size() && !found; head++) {
+		int curr_id = todo[head];
+		if(stats != NULL) stats->actorsExpanded++;
+		idspan neighbor_movies = db.getCreditIDs(curr_id);
+		for(idspan::iterator i = neighbor_movies.begin(); i != neighbor_movies.end() && !found; ++i) {
+			int movie_id = *i;
+			if(!visited.visit(movie_id)) continue;
+
+			if(stats != NULL) stats->moviesExpanded++;
+			idspan neighbor_actors = db.getCastIDs(movie_id);
+			for(idspan::iterator j = neighbor_actors.begin(); j != neighbor_actors.end(); ++j) {
+				int actor_id = *j;
+				if(visited.reached[actor_id]) continue;
+				visited.reach(actor_id, curr_id, movie_id);
+				if(actor_id == target_id) {
+					found = true;
+					break;
+				}
+				todo.push_back(actor_id);
+			}
+		}
+	}
+	if(!found) {
+		return false;
+	}
+
+	// build the path by walking the parent links back from the target
+	vector<int> legs;
+	for(int curr = target_id; curr != source_id; curr = visited.parentActor[curr]) {
+		legs.push_back(curr);
+	}
+	result = path(source);
+	for(int i = legs.size() - 1; i >= 0; i--) {
+		addConnection(db, result, visited.parentMovie[legs[i]], legs[i]);
+	}
+	return true;
+}
+
+/**
+ * The landmark lower bound on the distance between two actors, given each
+ * one's distances from the landmarks, or INT_MAX if some landmark reaches
+ * one of them but not the other.
+ */
+static int lowerBound(const unsigned char *from, const unsigned char *to, int landmarks) {
+	int bound = 0;
+	for(int k = 0; k < landmarks; k++) {
+		if(from[k] == imdb::kNoDistance && to[k] == imdb::kNoDistance) continue;
+		if(from[k] == imdb::kNoDistance || to[k] == imdb::kNoDistance) return INT_MAX;
+		bound = max(bound, abs(from[k] - to[k]));
+	}
+	return bound;
+}
+
+bool landmarkBounds(const imdb& db, int sourceID, int targetID, int& lower, int& upper) {
+	lower = sourceID == targetID ? 0 : 1;
+	upper = sourceID == targetID ? 0 : INT_MAX;
+	if(!db.hasLandmarks() || sourceID == targetID) return true;
+	const unsigned char *from = db.getLandmarkDistances(sourceID);
+	const unsigned char *to = db.getLandmarkDistances(targetID);
+	int landmarks = db.getLandmarkCount();
+	int bound = lowerBound(from, to, landmarks);
+	if(bound == INT_MAX) return false;
+	lower = max(lower, bound);
+	for(int k = 0; k < landmarks; k++) {
+		if(from[k] != imdb::kNoDistance) upper = min(upper, from[k] + to[k]);
+	}
+	return true;
+}
+
+/**
+ * Expands every actor in the side's current frontier by one level.  Returns
+ * true and sets meeting as soon as an actor already reached by the other
+ * side is discovered.  Because the sides take turns expanding full levels
+ * and stop at the first meeting, every meeting actor found in the level
+ * yields a path of the same (shortest) length, so the first one suffices.
+ *
+ * If goal is non-NULL, it holds the landmark distances of the actor at the
+ * far end, and newly discovered actors that can't be on a path of length at
+ * most limit are passed over.  No actor on a shortest path ever is, so the
+ * meeting (and its length) is unaffected.
+ */
+static bool expandLevel(const imdb& db, searchscratch::side& side, const searchscratch::side& other,
+		const unsigned char *goal, int limit, int& meeting, searchstats *stats) {
+	vector<int> next;
+	int depth = side.depth + 1;
+	for(unsigned i = 0; i < side.current.size(); i++) {
+		int curr_id = side.current[i];
+		if(stats != NULL) stats->actorsExpanded++;
+		idspan neighbor_movies = db.getCreditIDs(curr_id);
+		for(idspan::iterator j = neighbor_movies.begin(); j != neighbor_movies.end(); ++j) {
+			int movie_id = *j;
+			if(!side.visit(movie_id)) continue;
+
+			if(stats != NULL) stats->moviesExpanded++;
+			idspan neighbor_actors = db.getCastIDs(movie_id);
+			for(idspan::iterator k = neighbor_actors.begin(); k != neighbor_actors.end(); ++k) {
+				int actor_id = *k;
+				if(side.reached[actor_id]) continue;
+				if(goal != NULL && (long long) depth +
+						lowerBound(db.getLandmarkDistances(actor_id), goal, db.getLandmarkCount()) > limit) continue;
+				side.reach(actor_id, curr_id, movie_id);
+				if(other.reached[actor_id]) {
+					meeting = actor_id;
+					return true;
+				}
+				next.push_back(actor_id);
+			}
+		}
+	}
+	side.current.swap(next);
+	side.depth = depth;
+	return false;
+}
+
+bool findShortestPathBidirectional(const imdb& db, const string& source, const string& target,
+		path& result, searchstats *stats) {
+	searchscratch scratch;
+	return findShortestPathBidirectional(db, source, target, result, scratch, stats);
+}
+
+bool findShortestPathBidirectional(const imdb& db, const string& source, const string& target,
+		path& result, searchscratch& scratch, searchstats *stats) {
+	result = path(source);
+	if(source == target) return true;
+	int source_id = db.getActorID(source);
+	int target_id = db.getActorID(target);
+	if(source_id == imdb::kNoID || target_id == imdb::kNoID) return false;
+
+	int lower, upper;
+	if(!landmarkBounds(db, source_id, target_id, lower, upper)) return false;
+	const unsigned char *source_distances = NULL, *target_distances = NULL;
+	if(db.hasLandmarks()) {
+		source_distances = db.getLandmarkDistances(source_id);
+		target_distances = db.getLandmarkDistances(target_id);
+	}
+
+	searchscratch::side& forward = scratch.forward;
+	searchscratch::side& backward = scratch.backward;
+	forward.prepare(db, source_id);
+	backward.prepare(db, target_id);
+	int meeting = imdb::kNoID;
+	bool met = false;
+	while(!met && !forward.current.empty() && !backward.current.empty()) {
+		if(forward.current.size() <= backward.current.size()) {
+			met = expandLevel(db, forward, backward, target_distances, upper, meeting, stats);
+		} else {
+			met = expandLevel(db, backward, forward, source_distances, upper, meeting, stats);
+		}
+	}
+	if(!met) return false;
+
+	// walk from the meeting point back to the source, then forward to the target
+	vector<int> legs;
+	for(int curr = meeting; curr != source_id; curr = forward.parentActor[curr]) {
+		legs.push_back(curr);
+	}
+	for(int i = legs.size() - 1; i >= 0; i--) {
+		addConnection(db, result, forward.parentMovie[legs[i]], legs[i]);
+	}
+	for(int curr = meeting; curr != target_id; curr = backward.parentActor[curr]) {
+		addConnection(db, result, backward.parentMovie[curr], backward.parentActor[curr]);
+	}
+	return true;
+}
+
+int findDistance(const imdb& db, const string& source, const string& target, searchstats *stats) {
+	if(source == target) return 0;
+	int source_id = db.getActorID(source);
+	int target_id = db.getActorID(target);
+	if(source_id == imdb::kNoID || target_id == imdb::kNoID) return kUnreachable;
+	int lower, upper;
+	if(!landmarkBounds(db, source_id, target_id, lower, upper)) return kUnreachable;
+	if(lower == upper) return lower;
+	path p(source);
+	if(!findShortestPathBidirectional(db, source, target, p, stats)) return kUnreachable;
+	return p.getLength();
+}
+
+/**
+ * Runs the breadth-first search behind computeDistances, but stops once the
+ * level holding the target (if there is one) has been discovered, leaving
+ * the actors past it marked unreachable.
+ */
+static void spreadDistances(const imdb& db, int sourceID, int targetID, vector<int>& distances,
+		searchstats *stats) {
+	distances.assign(db.getActorCount(), kUnreachable);
+	vector<bool> visitedMovie(db.getMovieCount(), false);
+	vector<int> current(1, sourceID), next;
+	distances[sourceID] = 0;
+	for(int distance = 1; !current.empty(); distance++) {
+		if(targetID != imdb::kNoID && distances[targetID] != kUnreachable) break;
+		for(unsigned i = 0; i < current.size(); i++) {
+			if(stats != NULL) stats->actorsExpanded++;
+			idspan neighbor_movies = db.getCreditIDs(current[i]);
+			for(idspan::iterator j = neighbor_movies.begin(); j != neighbor_movies.end(); ++j) {
+				int movie_id = *j;
+				if(visitedMovie[movie_id]) continue;
+				visitedMovie[movie_id] = true;
+
+				if(stats != NULL) stats->moviesExpanded++;
+				idspan neighbor_actors = db.getCastIDs(movie_id);
+				for(idspan::iterator k = neighbor_actors.begin(); k != neighbor_actors.end(); ++k) {
+					int actor_id = *k;
+					if(distances[actor_id] != kUnreachable) continue;
+					distances[actor_id] = distance;
+					next.push_back(actor_id);
+				}
+			}
+		}
+		current.swap(next);
+		next.clear();
+	}
+}
+
+void computeDistances(const imdb& db, int sourceID, vector<int>& distances, searchstats *stats) {
+	spreadDistances(db, sourceID, imdb::kNoID, distances, stats);
+}
+
+void buildSearchTree(const imdb& db, int sourceID, searchtree& tree, searchstats *stats) {
+	tree.sourceID = sourceID;
+	tree.parentActor.assign(db.getActorCount(), imdb::kNoID);
+	tree.parentMovie.assign(db.getActorCount(), imdb::kNoID);
+	vector<bool> reached(db.getActorCount(), false), visitedMovie(db.getMovieCount(), false);
+	vector<int> todo(1, sourceID);
+	reached[sourceID] = true;
+	for(size_t head = 0; head < todo.size(); head++) {
+		int curr_id = todo[head];
+		if(stats != NULL) stats->actorsExpanded++;
+		idspan neighbor_movies = db.getCreditIDs(curr_id);
+		for(idspan::iterator i = neighbor_movies.begin(); i != neighbor_movies.end(); ++i) {
+			int movie_id = *i;
+			if(visitedMovie[movie_id]) continue;
+			visitedMovie[movie_id] = true;
+
+			if(stats != NULL) stats->moviesExpanded++;
+			idspan neighbor_actors = db.getCastIDs(movie_id);
+			for(idspan::iterator j = neighbor_actors.begin(); j != neighbor_actors.end(); ++j) {
+				int actor_id = *j;
+				if(reached[actor_id]) continue;
+				reached[actor_id] = true;
+				tree.parentActor[actor_id] = curr_id;
+				tree.parentMovie[actor_id] = movie_id;
+				todo.push_back(actor_id);
+			}
+		}
+	}
+}
+
+bool findPathInTree(const imdb& db, const searchtree& tree, int targetID, path& result) {
+	result = path(db.getActorName(tree.sourceID));
+	if(targetID == tree.sourceID) return true;
+	if(tree.parentActor[targetID] == imdb::kNoID) return false;
+	vector<int> legs;
+	for(int curr = targetID; curr != tree.sourceID; curr = tree.parentActor[curr]) {
+		legs.push_back(curr);
+	}
+	for(int i = legs.size() - 1; i >= 0; i--) {
+		addConnection(db, result, tree.parentMovie[legs[i]], legs[i]);
+	}
+	return true;
+}
+
+pathdag::pathdag(const imdb& db, const string& source, const string& target, searchstats *stats) :
+	db(db), source(source), length(kUnreachable), pathCount(0) {
+	sourceID = db.getActorID(source);
+	targetID = db.getActorID(target);
+	int lower, upper;
+	if(sourceID == imdb::kNoID || targetID == imdb::kNoID ||
+		!landmarkBounds(db, sourceID, targetID, lower, upper)) return;
+	vector<int> distances;
+	spreadDistances(db, sourceID, targetID, distances, stats);
+	length = distances[targetID];
+	if(length == kUnreachable) return;
+
+	// sweep back from the target a level at a time, keeping every connection
+	// from the level before that leads to an actor already kept
+	vector<vector<int>> levels(length + 1);
+	vector<bool> kept(db.getActorCount(), false);
+	levels[length].push_back(targetID);
+	kept[targetID] = true;
+	for(int level = length; level > 0; level--) {
+		for(unsigned i = 0; i < levels[level].size(); i++) {
+			int curr_id = levels[level][i];
+			idspan neighbor_movies = db.getCreditIDs(curr_id);
+			for(idspan::iterator j = neighbor_movies.begin(); j != neighbor_movies.end(); ++j) {
+				int movie_id = *j;
+				idspan neighbor_actors = db.getCastIDs(movie_id);
+				for(idspan::iterator k = neighbor_actors.begin(); k != neighbor_actors.end(); ++k) {
+					int actor_id = *k;
+					if(distances[actor_id] != level - 1) continue;
+					edge e = { actor_id, movie_id, curr_id, 0 };
+					edges.push_back(e);
+					if(kept[actor_id]) continue;
+					kept[actor_id] = true;
+					levels[level - 1].push_back(actor_id);
+				}
+			}
+		}
+	}
+	sort(edges.begin(), edges.end(), [](const edge& a, const edge& b) {
+		if(a.from != b.from) return a.from < b.from;
+		return a.movie != b.movie ? a.movie < b.movie : a.to < b.to;
+	});
+	for(unsigned i = 0; i < edges.size(); i++) edges[i].year = db.getMovie(edges[i].movie).year;
+
+	// count the paths from each kept actor to the target, the last level first
+	vector<unsigned long long> counts(db.getActorCount(), 0);
+	counts[targetID] = 1;
+	for(int level = length - 1; level >= 0; level--) {
+		for(unsigned i = 0; i < levels[level].size(); i++) {
+			int curr_id = levels[level][i];
+			edge key = { curr_id, 0, 0, 0 };
+			vector<edge>::const_iterator it = lower_bound(edges.begin(), edges.end(), key,
+				[](const edge& a, const edge& b) { return a.from < b.from; });
+			unsigned long long count = 0;
+			for(; it != edges.end() && it->from == curr_id; ++it) {
+				count = counts[it->to] > ULLONG_MAX - count ? ULLONG_MAX : count + counts[it->to];
+			}
+			counts[curr_id] = count;
+		}
+	}
+	pathCount = counts[sourceID];
+}
+
+int pathdag::getLength() const {
+	return length;
+}
+
+unsigned long long pathdag::getPathCount() const {
+	return pathCount;
+}
+
+size_t pathdag::forEachPath(pathorder order, const function<bool(const path&)>& visit) const {
+	if(length == kUnreachable) return 0;
+	vector<edge> ordered(edges);
+	if(order == kNewestFirst) {
+		stable_sort(ordered.begin(), ordered.end(), [](const edge& a, const edge& b) {
+			return a.from != b.from ? a.from < b.from : a.year > b.year;
+		});
+	}
+	path p(source);
+	size_t visited = 0;
+	walk(ordered, sourceID, p, visit, visited);
+	return visited;
+}
+
+/**
+ * Extends the path by each of the actor's connections in turn, recursing
+ * until the target is reached.  Returns false once visit has asked to stop.
+ */
+bool pathdag::walk(const vector<edge>& ordered, int actorID, path& p,
+		const function<bool(const path&)>& visit, size_t& visited) const {
+	if(actorID == targetID) {
+		visited++;
+		return visit(p);
+	}
+	edge key = { actorID, 0, 0, 0 };
+	vector<edge>::const_iterator it = lower_bound(ordered.begin(), ordered.end(), key,
+		[](const edge& a, const edge& b) { return a.from < b.from; });
+	for(; it != ordered.end() && it->from == actorID; ++it) {
+		addConnection(db, p, it->movie, it->to);
+		bool more = walk(ordered, it->to, p, visit, visited);
+		p.undoConnection();
+		if(!more) return false;
+	}
+	return true;
+}
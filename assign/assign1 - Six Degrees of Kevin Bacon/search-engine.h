@@ -0,0 +1,295 @@
+#pragma once
+#include "imdb.h"
+#include "path.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+
+/**
+ * Convenience struct: searchstats
+ * -------------------------------
+ * Counters populated by the search routines below so that clients
+ * (the benchmark, mostly) can see how much of the database a query
+ * had to touch.  An actor is expanded each time its credits are
+ * fetched, and a movie is expanded each time its cast is fetched.
+ */
+struct searchstats {
+  size_t actorsExpanded;
+  size_t moviesExpanded;
+
+  searchstats() : actorsExpanded(0), moviesExpanded(0) {}
+};
+
+/**
+ * Class: searchscratch
+ * --------------------
+ * Working memory for the search routines: visited sets and parent links
+ * sized to the database, along with the frontiers.  Allocating and clearing
+ * all of that dominates the cost of a short query, so a long-running client
+ * keeps one searchscratch per thread and passes it to every query that
+ * thread runs.  Only the entries a query actually touched are cleared
+ * before the next one.  A searchscratch may be moved on to a different imdb
+ * (after a reload, say); the first query against the new one starts over
+ * with freshly sized sets.
+ */
+class searchscratch {
+ public:
+  searchscratch() {}
+
+  /**
+   * One side of a search, grown from either the source or the target.  The
+   * single-ended search only ever uses the forward side.  parentActor and
+   * parentMovie are only meaningful for actors whose reached bit is set.
+   * depth is the number of levels the side has been expanded by, and
+   * preparedFor is the imdb the sets are currently sized to.
+   */
+  struct side {
+    int depth;
+    const imdb* preparedFor = nullptr;
+    std::vector<bool> reached;
+    std::vector<bool> visitedMovie;
+    std::vector<int> parentActor;
+    std::vector<int> parentMovie;
+    std::vector<int> current;
+    std::vector<int> touchedActors;
+    std::vector<int> touchedMovies;
+
+    void prepare(const imdb& db, int root);
+    void reach(int actor, int parent, int movie) {
+      reached[actor] = true;
+      parentActor[actor] = parent;
+      parentMovie[actor] = movie;
+      touchedActors.push_back(actor);
+    }
+    bool visit(int movie) {
+      if (visitedMovie[movie]) return false;
+      visitedMovie[movie] = true;
+      touchedMovies.push_back(movie);
+      return true;
+    }
+  };
+
+  side forward;
+  side backward;
+
+ private:
+  searchscratch(const searchscratch& original) = delete;
+  searchscratch& operator=(const searchscratch& rhs) = delete;
+};
+
+/**
+ * Function: findShortestPath
+ * --------------------------
+ * Runs a breadth-first search outward from the source actor/actress
+ * until the target is reached, and returns the first shortest path
+ * discovered via the supplied path reference.
+ *
+ * @param db the imdb to be searched.
+ * @param source the actor/actress at the start of the path.
+ * @param target the actor/actress at the end of the path.
+ * @param result updated to hold the path from source to target, if one exists.
+ * @param scratch working memory to reuse; the first form allocates its own.
+ * @param stats optional counters updated with the amount of work done.
+ * @return true if and only if a path between source and target was found.
+ */
+bool findShortestPath(const imdb& db, const std::string& source, const std::string& target,
+                      path& result, searchstats *stats = NULL);
+bool findShortestPath(const imdb& db, const std::string& source, const std::string& target,
+                      path& result, searchscratch& scratch, searchstats *stats = NULL);
+
+/**
+ * Function: findShortestPathBidirectional
+ * ---------------------------------------
+ * Identical in contract to findShortestPath, except that the search grows
+ * one frontier from the source and a second from the target, always
+ * expanding the smaller of the two by one full level, and stops as soon
+ * as the two meet.  The path found is of the same (shortest) length as
+ * the one findShortestPath finds, though it needn't be the same path.
+ *
+ * When the imdb has landmarks, a query between actors the landmarks show to
+ * be disconnected fails straight away, and neither side keeps any actor that
+ * the landmark bounds (see landmarkBounds) prove can't be on a shortest path.
+ */
+bool findShortestPathBidirectional(const imdb& db, const std::string& source, const std::string& target,
+                                   path& result, searchstats *stats = NULL);
+bool findShortestPathBidirectional(const imdb& db, const std::string& source, const std::string& target,
+                                   path& result, searchscratch& scratch, searchstats *stats = NULL);
+
+/**
+ * Constant: kUnreachable
+ * ----------------------
+ * The distance computeDistances and findDistance report when there is no path.
+ */
+const int kUnreachable = -1;
+
+/**
+ * Function: landmarkBounds
+ * ------------------------
+ * Bounds the length of the shortest path between two actors/actresses using
+ * the imdb's landmarks, if it has any.  By the triangle inequality, the
+ * distance from source to target is at least the difference, and at most
+ * the sum, of their distances from any one landmark.  A landmark that
+ * reaches one but not the other proves there's no path at all.  Without
+ * landmarks, the bounds are 0 (or 1, for distinct actors) and INT_MAX.
+ *
+ * @param db the imdb to be consulted.
+ * @param sourceID the ID of the actor/actress at one end.
+ * @param targetID the ID of the actor/actress at the other end.
+ * @param lower updated to hold a lower bound on the distance.
+ * @param upper updated to hold an upper bound on the distance.
+ * @return false if the landmarks prove there's no path between the two,
+ *         and true otherwise.
+ */
+bool landmarkBounds(const imdb& db, int sourceID, int targetID, int& lower, int& upper);
+
+/**
+ * Function: findDistance
+ * ----------------------
+ * Returns the length of the shortest path between the two actors/actresses,
+ * or kUnreachable if either isn't in the database or there's no path.  When
+ * the landmark bounds meet, the distance is returned without searching at
+ * all, and otherwise the (pruned) bidirectional search settles it.
+ */
+int findDistance(const imdb& db, const std::string& source, const std::string& target,
+                 searchstats *stats = NULL);
+
+/**
+ * Function: findShortestPathParallel
+ * ----------------------------------
+ * Identical in contract and in result to findShortestPath: the path found
+ * is exactly the one findShortestPath finds.  The search proceeds one level
+ * at a time, with each level's frontier split across numThreads threads.
+ * Every actor discovered in a level keeps the discovery the serial search
+ * would have made first, so parent links and frontier order (and with them
+ * the path) don't depend on the number of threads or how they interleave.
+ */
+bool findShortestPathParallel(const imdb& db, const std::string& source, const std::string& target,
+                              path& result, size_t numThreads, searchstats *stats = NULL);
+
+/**
+ * Function: computeDistances
+ * --------------------------
+ * Runs a single breadth-first search over the entire graph from the
+ * specified actor/actress, recording the length of the shortest path to
+ * every actor/actress (0 for the source itself, kUnreachable for those in
+ * another component).  Only the distances, one visited bit per movie and
+ * the frontiers are kept, so memory is proportional to the number of
+ * actors and movies, however many paths there are.
+ *
+ * @param db the imdb to be searched.
+ * @param sourceID the ID of the actor/actress distances are measured from.
+ * @param distances resized to hold one distance per actor ID.
+ * @param stats optional counters updated with the amount of work done.
+ */
+void computeDistances(const imdb& db, int sourceID, std::vector<int>& distances,
+                      searchstats *stats = NULL);
+
+/**
+ * Convenience struct: searchtree
+ * ------------------------------
+ * The parent links left by a breadth-first search from one actor/actress
+ * that ran until it had reached everyone it could.  A long-running client
+ * that keeps the tree for a frequent source can then answer a query from
+ * that source to anyone by walking the links back from the target.
+ */
+struct searchtree {
+  int sourceID;
+  std::vector<int> parentActor;
+  std::vector<int> parentMovie;
+};
+
+/**
+ * Functions: buildSearchTree
+ *            findPathInTree
+ * ---------------------------
+ * buildSearchTree runs the same breadth-first search as findShortestPath,
+ * from the specified actor/actress, but to completion, recording the parent
+ * links of everyone reached.  findPathInTree then returns, via result, the
+ * path from the tree's source to the target, or false if the target wasn't
+ * reached.  Parent links are fixed the moment an actor is first discovered,
+ * so the path is exactly the one findShortestPath would have found.
+ */
+void buildSearchTree(const imdb& db, int sourceID, searchtree& tree, searchstats *stats = NULL);
+bool findPathInTree(const imdb& db, const searchtree& tree, int targetID, path& result);
+
+/**
+ * Class: pathdag
+ * --------------
+ * Every shortest path between two actors/actresses, held as the directed
+ * acyclic graph of the connections that lie on at least one of them.  The
+ * graph is built once, by a breadth-first search out from the source that
+ * stops after the target's level and a sweep back from the target that keeps
+ * only the connections leading to it.  The paths themselves are never stored:
+ * forEachPath walks the graph depth first, reusing a single path, so even
+ * an enormous number of paths costs no more memory than the graph.
+ */
+class pathdag {
+ public:
+
+/**
+ * Enumeration: pathorder
+ * ----------------------
+ * The order in which forEachPath produces the paths.  kTitleOrder takes each
+ * actor/actress's connections in order of movie (title, then year) and then
+ * co-star name.  kNewestFirst takes the newest movies first, so the paths
+ * come out ordered by the year of their first movie (newest first) and,
+ * among those sharing a first movie, by the year of their second, and so
+ * on.  Either way, the first k paths produced are the top k in that order.
+ */
+  enum pathorder { kTitleOrder, kNewestFirst };
+
+/**
+ * Constructor: pathdag
+ * --------------------
+ * Builds the graph of shortest paths from source to target.  If either
+ * isn't in the database, or there's no path between them, the graph is
+ * empty and getLength() returns kUnreachable.
+ */
+  pathdag(const imdb& db, const std::string& source, const std::string& target,
+          searchstats *stats = NULL);
+
+/**
+ * Methods: getLength
+ *          getPathCount
+ * ---------------------
+ * Returns the length of the shortest paths (or kUnreachable), and the number
+ * of them, counted without enumerating them.  The count saturates at
+ * ULLONG_MAX.
+ */
+  int getLength() const;
+  unsigned long long getPathCount() const;
+
+/**
+ * Method: forEachPath
+ * -------------------
+ * Passes each shortest path in turn to visit, in the specified order, until
+ * visit returns false or the paths run out.  The path passed is only valid
+ * for the duration of the call.
+ *
+ * @return the number of paths passed to visit.
+ */
+  size_t forEachPath(pathorder order, const std::function<bool(const path&)>& visit) const;
+
+ private:
+  struct edge {
+    int from;
+    int movie;
+    int to;
+    int year;
+  };
+
+  const imdb& db;
+  std::string source;
+  int sourceID;
+  int targetID;
+  int length;
+  unsigned long long pathCount;
+  std::vector<edge> edges;  // sorted by from, then movie, then to
+
+  bool walk(const std::vector<edge>& ordered, int actorID, path& p,
+            const std::function<bool(const path&)>& visit, size_t& visited) const;
+
+  pathdag(const pathdag& original) = delete;
+  pathdag& operator=(const pathdag& rhs) = delete;
+};
@@ -0,0 +1,185 @@
+#include "search-engine.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+using namespace std;
+
+/**
+ * Every actor discovered in a level is tagged with the position at which the
+ * serial search would have discovered it: the level, the index of the
+ * frontier actor being expanded, the position of the movie within that
+ * actor's credits and the position of the actor within that movie's cast,
+ * packed into one 64-bit key so that comparing keys compares positions.
+ * Credit and cast counts are stored as shorts, so 15 bits suffice for each.
+ * Movies are claimed with the same keys, minus the cast position.
+ */
+static const int kPositionBits = 15;
+static const int kFrontierBits = 24;
+static const int kLevelShift = 2 * kPositionBits + kFrontierBits;
+static const uint64_t kMaxLevel = (1ull << (64 - kLevelShift)) - 1;
+static const uint64_t kUnclaimed = UINT64_MAX;
+static const size_t kChunkSize = 64;
+
+static uint64_t makeKey(uint64_t level, uint64_t index, uint64_t credit, uint64_t cast) {
+	return (level << kLevelShift) | (index << (2 * kPositionBits)) | (credit << kPositionBits) | cast;
+}
+
+static size_t keyIndex(uint64_t key) {
+	return (key >> (2 * kPositionBits)) & ((1ull << kFrontierBits) - 1);
+}
+
+static size_t keyCredit(uint64_t key) {
+	return (key >> kPositionBits) & ((1ull << kPositionBits) - 1);
+}
+
+/**
+ * Lowers slot to value unless it's already lower, returning what was there.
+ */
+static uint64_t lowerTo(atomic<uint64_t>& slot, uint64_t value) {
+	uint64_t curr = slot.load(memory_order_relaxed);
+	while(value < curr && !slot.compare_exchange_weak(curr, value, memory_order_relaxed)) {}
+	return curr;
+}
+
+/**
+ * Runs fn(t) for every t in [0, numThreads), the calling thread being
+ * thread 0, and returns once all of them have.  Joining the helpers is what
+ * orders one phase of a level before the next.
+ */
+template <typename Function>
+static void runOnThreads(size_t numThreads, Function fn) {
+	vector<thread> helpers;
+	for(size_t t = 1; t < numThreads; t++) helpers.push_back(thread(fn, t));
+	fn(0);
+	for(unsigned t = 0; t < helpers.size(); t++) helpers[t].join();
+}
+
+/**
+ * Hands out the frontier in small chunks, so that a few prolific actors
+ * don't leave one thread doing all the work of a level.
+ */
+template <typename Function>
+static void forEachFrontierIndex(atomic<size_t>& cursor, size_t size, Function fn) {
+	while(true) {
+		size_t start = cursor.fetch_add(kChunkSize);
+		if(start >= size) return;
+		for(size_t i = start; i < min(start + kChunkSize, size); i++) fn(i);
+	}
+}
+
+bool findShortestPathParallel(const imdb& db, const string& source, const string& target,
+		path& result, size_t numThreads, searchstats *stats) {
+	if(source == target) {
+		result = path(source);
+		return true;
+	}
+	int source_id = db.getActorID(source);
+	int target_id = db.getActorID(target);
+	if(source_id == imdb::kNoID || target_id == imdb::kNoID) return false;
+	if((uint64_t) db.getActorCount() >= (1ull << kFrontierBits)) {
+		return findShortestPath(db, source, target, result, stats);
+	}
+	numThreads = max<size_t>(numThreads, 1);
+
+	vector<atomic<uint64_t>> discovered((db.getActorCount() + 63) / 64);
+	vector<atomic<uint64_t>> actorKey(db.getActorCount());
+	vector<atomic<uint64_t>> movieKey(db.getMovieCount());
+	for(unsigned i = 0; i < discovered.size(); i++) discovered[i].store(0, memory_order_relaxed);
+	for(unsigned i = 0; i < actorKey.size(); i++) actorKey[i].store(kUnclaimed, memory_order_relaxed);
+	for(unsigned i = 0; i < movieKey.size(); i++) movieKey[i].store(kUnclaimed, memory_order_relaxed);
+	vector<int> parent_actor(db.getActorCount()), parent_movie(db.getActorCount());
+	vector<vector<int>> found(numThreads);
+	vector<size_t> expanded_movies(numThreads);
+
+	vector<int> frontier(1, source_id), next;
+	discovered[source_id / 64].fetch_or(1ull << (source_id % 64));
+	actorKey[source_id].store(0);
+	for(uint64_t level = 1; !frontier.empty(); level++) {
+		if(level > kMaxLevel) return findShortestPath(db, source, target, result, stats);
+		if(stats != NULL) stats->actorsExpanded += frontier.size();
+
+		// phase 1: each movie not yet expanded goes to the first frontier actor crediting it
+		atomic<size_t> cursor(0);
+		runOnThreads(numThreads, [&](size_t t) {
+			forEachFrontierIndex(cursor, frontier.size(), [&](size_t i) {
+				idspan credits = db.getCreditIDs(frontier[i]);
+				for(size_t p = 0; p < credits.size(); p++) {
+					lowerTo(movieKey[credits[p]], makeKey(level, i, p, 0));
+				}
+			});
+		});
+
+		// phase 2: expand the claimed movies, keeping each new actor's earliest discovery
+		cursor.store(0);
+		runOnThreads(numThreads, [&](size_t t) {
+			found[t].clear();
+			expanded_movies[t] = 0;
+			uint64_t level_base = makeKey(level, 0, 0, 0);
+			forEachFrontierIndex(cursor, frontier.size(), [&](size_t i) {
+				idspan credits = db.getCreditIDs(frontier[i]);
+				for(size_t p = 0; p < credits.size(); p++) {
+					int movie_id = credits[p];
+					if(movieKey[movie_id].load(memory_order_relaxed) != makeKey(level, i, p, 0)) continue;
+					expanded_movies[t]++;
+					idspan cast = db.getCastIDs(movie_id);
+					size_t q = 0;
+					for(idspan::iterator it = cast.begin(); it != cast.end(); ++it, q++) {
+						int actor_id = *it;
+						if(actorKey[actor_id].load(memory_order_relaxed) < level_base) continue;
+						lowerTo(actorKey[actor_id], makeKey(level, i, p, q));
+						uint64_t bit = 1ull << (actor_id % 64);
+						if((discovered[actor_id / 64].fetch_or(bit, memory_order_relaxed) & bit) == 0) {
+							found[t].push_back(actor_id);
+						}
+					}
+				}
+			});
+		});
+
+		// phase 3: record parents and sort each thread's discoveries into serial queue order
+		auto earlier = [&](int a, int b) {
+			return actorKey[a].load(memory_order_relaxed) < actorKey[b].load(memory_order_relaxed);
+		};
+		vector<size_t> bounds(numThreads + 1, 0);
+		for(size_t t = 0; t < numThreads; t++) bounds[t + 1] = bounds[t] + found[t].size();
+		next.resize(bounds[numThreads]);
+		runOnThreads(numThreads, [&](size_t t) {
+			for(unsigned j = 0; j < found[t].size(); j++) {
+				int actor_id = found[t][j];
+				uint64_t key = actorKey[actor_id].load(memory_order_relaxed);
+				parent_actor[actor_id] = frontier[keyIndex(key)];
+				parent_movie[actor_id] = db.getCreditIDs(parent_actor[actor_id])[keyCredit(key)];
+			}
+			sort(found[t].begin(), found[t].end(), earlier);
+			copy(found[t].begin(), found[t].end(), next.begin() + bounds[t]);
+		});
+
+		// then merge the sorted runs pairwise, each round's merges running in parallel
+		for(size_t width = 1; width < numThreads; width *= 2) {
+			size_t pairs = (numThreads + 2 * width - 1) / (2 * width);
+			runOnThreads(pairs, [&](size_t k) {
+				size_t lo = 2 * k * width, mid = min(lo + width, numThreads), hi = min(lo + 2 * width, numThreads);
+				inplace_merge(next.begin() + bounds[lo], next.begin() + bounds[mid], next.begin() + bounds[hi], earlier);
+			});
+		}
+		if(stats != NULL) {
+			for(size_t t = 0; t < numThreads; t++) stats->moviesExpanded += expanded_movies[t];
+		}
+		frontier.swap(next);
+		if(actorKey[target_id].load() != kUnclaimed) break;
+	}
+	if(actorKey[target_id].load() == kUnclaimed) return false;
+
+	// walk the parent links back from the target
+	vector<int> legs;
+	for(int curr = target_id; curr != source_id; curr = parent_actor[curr]) {
+		legs.push_back(curr);
+	}
+	result = path(source);
+	for(int i = legs.size() - 1; i >= 0; i--) {
+		result.addConnection(db.getMovie(parent_movie[legs[i]]), db.getActorName(legs[i]));
+	}
+	return true;
+}
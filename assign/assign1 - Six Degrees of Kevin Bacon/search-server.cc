@@ -0,0 +1,305 @@
+#include "search-server.h"
+#include "path.h"
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <list>
+#include <sstream>
+using namespace std;
+
+static volatile sig_atomic_t shutdownRequested = 0;
+static volatile sig_atomic_t reloadRequested = 0;
+static const int kAcceptPollMillis = 250;
+
+/**
+ * The answers owed to one stream.  answers[i] holds the answer to query
+ * number base + i once done[i] is set; the writer thread pops answers off
+ * the front, in order, as they become available.
+ */
+struct queryserver::session {
+	int outfd;
+	mutex lock;
+	condition_variable answered;
+	deque<string> answers;
+	deque<bool> done;
+	size_t base;
+	bool closed;
+
+	session(int outfd) : outfd(outfd), base(0), closed(false) {}
+};
+
+queryserver::queryserver(imdbhandle& handle, size_t numThreads, bool bidirectional, size_t cacheBytes) :
+	handle(handle), bidirectional(bidirectional), stopping(false) {
+	if(cacheBytes > 0) cache.reset(new querycache(cacheBytes));
+	for(size_t i = 0; i < max<size_t>(numThreads, 1); i++) {
+		workers.push_back(thread([this] { work(); }));
+	}
+}
+
+queryserver::~queryserver() {
+	{
+		lock_guard<mutex> lg(queueLock);
+		stopping = true;
+	}
+	queueChanged.notify_all();
+	for(unsigned i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+void queryserver::requestShutdown() {
+	shutdownRequested = 1;
+}
+
+void queryserver::requestReload() {
+	reloadRequested = 1;
+}
+
+/**
+ * Each worker owns one searchscratch for its whole life, so after its first
+ * query it never allocates visited sets or parent links again (until a
+ * reload swaps in a different database, when they're sized afresh).
+ */
+void queryserver::work() {
+	searchscratch scratch;
+	while(true) {
+		job next;
+		{
+			unique_lock<mutex> ul(queueLock);
+			queueChanged.wait(ul, [this] { return stopping || !queue.empty(); });
+			if(queue.empty()) return;
+			next = queue.front();
+			queue.pop_front();
+		}
+
+		chrono::steady_clock::time_point start = chrono::steady_clock::now();
+		string text = answer(next.query, scratch);
+		chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+		{
+			lock_guard<mutex> lg(latencyLock);
+			latencies.push_back(elapsed.count());
+		}
+
+		session& s = *next.owner;
+		{
+			lock_guard<mutex> lg(s.lock);
+			s.answers[next.sequence - s.base] = text;
+			s.done[next.sequence - s.base] = true;
+		}
+		s.answered.notify_all();
+	}
+}
+
+string queryserver::answer(const string& query, searchscratch& scratch) const {
+	size_t tab = query.find('\t');
+	if(tab == string::npos) {
+		return "Malformed query: expected <source-actor><TAB><target-actor>\n\n";
+	}
+	string source = query.substr(0, tab);
+	string target = query.substr(tab + 1);
+	shared_ptr<const imdb> db = handle.get();
+	int source_id = db->getActorID(source), target_id = db->getActorID(target);
+	if(cache == NULL || source_id == imdb::kNoID || target_id == imdb::kNoID) {
+		path p(source);
+		bool found = bidirectional ? findShortestPathBidirectional(*db, source, target, p, scratch) :
+			findShortestPath(*db, source, target, p, scratch);
+		return formatAnswer(found, p);
+	}
+
+	string text;
+	if(cache->findAnswer(db, source_id, target_id, text)) return text;
+	path p(source);
+	bool found;
+	shared_ptr<const searchtree> tree = cache->findTree(db, source_id);
+	if(tree != NULL) found = findPathInTree(*db, *tree, target_id, p);
+	else if(bidirectional) found = findShortestPathBidirectional(*db, source, target, p, scratch);
+	else found = findShortestPath(*db, source, target, p, scratch);
+	text = formatAnswer(found, p);
+	cache->storeAnswer(db, source_id, target_id, text);
+	return text;
+}
+
+/**
+ * Formats an answer just as search prints it, followed by a blank line.
+ */
+string queryserver::formatAnswer(bool found, const path& p) {
+	ostringstream os;
+	if(!found) {
+		os << "No path between those two people could be found." << endl;
+	} else {
+		os << p;
+	}
+	os << endl;
+	return os.str();
+}
+
+static bool writeFully(int fd, const char *data, size_t length) {
+	while(length > 0) {
+		ssize_t written = write(fd, data, length);
+		if(written == -1 && errno == EINTR) continue;
+		if(written <= 0) return false;
+		data += written;
+		length -= written;
+	}
+	return true;
+}
+
+/**
+ * Runs on its own thread for as long as the session is open, writing each
+ * answer as soon as it and every answer before it are ready.  Once the peer
+ * stops reading, the remaining answers are still collected, just not written.
+ */
+void queryserver::writeAnswers(session& s) {
+	bool writable = true;
+	unique_lock<mutex> ul(s.lock);
+	while(true) {
+		s.answered.wait(ul, [&s] { return (!s.done.empty() && s.done.front()) || (s.closed && s.done.empty()); });
+		if(s.done.empty()) return;
+		string text;
+		text.swap(s.answers.front());
+		s.answers.pop_front();
+		s.done.pop_front();
+		s.base++;
+		ul.unlock();
+		if(writable) writable = writeFully(s.outfd, text.data(), text.size());
+		ul.lock();
+	}
+}
+
+void queryserver::serve(int infd, int outfd) {
+	session s(outfd);
+	thread writer([this, &s] { writeAnswers(s); });
+
+	size_t submitted = 0;
+	string pending;
+	char buffer[4096];
+	while(true) {
+		ssize_t count = read(infd, buffer, sizeof(buffer));
+		if(count == -1 && errno == EINTR) continue;
+		if(count <= 0) break;
+		pending.append(buffer, count);
+		size_t start = 0, newline;
+		while((newline = pending.find('\n', start)) != string::npos) {
+			string line = pending.substr(start, newline - start);
+			start = newline + 1;
+			if(!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+			if(line.empty()) continue;
+			{
+				lock_guard<mutex> lg(s.lock);
+				s.answers.push_back(string());
+				s.done.push_back(false);
+			}
+			job j = { &s, submitted++, line };
+			{
+				lock_guard<mutex> lg(queueLock);
+				queue.push_back(j);
+			}
+			queueChanged.notify_one();
+		}
+		pending.erase(0, start);
+	}
+
+	{
+		lock_guard<mutex> lg(s.lock);
+		s.closed = true;
+	}
+	s.answered.notify_all();
+	writer.join();
+}
+
+bool queryserver::serveSocket(const string& socketPath) {
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(socketPath.size() >= sizeof(address.sun_path)) return false;
+	strcpy(address.sun_path, socketPath.c_str());
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listener == -1) return false;
+	unlink(socketPath.c_str());
+	if(bind(listener, (struct sockaddr *) &address, sizeof(address)) == -1 || listen(listener, SOMAXCONN) == -1) {
+		close(listener);
+		return false;
+	}
+
+	// each connection's thread flags itself finished so it can be reaped
+	struct connection {
+		int fd;
+		bool finished;
+		thread server;
+	};
+	mutex connectionsLock;
+	list<connection> connections;
+	while(!shutdownRequested) {
+		struct pollfd pfd = { listener, POLLIN, 0 };
+		int ready = poll(&pfd, 1, kAcceptPollMillis);
+		if(reloadRequested) {
+			reloadRequested = 0;
+			string error;
+			if(handle.reload(error)) cerr << "Reloaded the imdb." << endl;
+			else cerr << "Couldn't reload the imdb (" << error << "); still serving the old one." << endl;
+		}
+		{
+			lock_guard<mutex> lg(connectionsLock);
+			for(list<connection>::iterator it = connections.begin(); it != connections.end(); ) {
+				if(!it->finished) { ++it; continue; }
+				it->server.join();
+				it = connections.erase(it);
+			}
+		}
+		if(ready <= 0) continue;
+		int client = accept(listener, NULL, NULL);
+		if(client == -1) continue;
+		lock_guard<mutex> lg(connectionsLock);
+		connections.push_back(connection());
+		connection& c = connections.back();
+		c.fd = client;
+		c.finished = false;
+		c.server = thread([this, &c, &connectionsLock] {
+			serve(c.fd, c.fd);
+			lock_guard<mutex> lg(connectionsLock);
+			close(c.fd);
+			c.finished = true;
+		});
+	}
+
+	close(listener);
+	unlink(socketPath.c_str());
+	{
+		lock_guard<mutex> lg(connectionsLock);
+		for(list<connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+			if(!it->finished) shutdown(it->fd, SHUT_RD);
+		}
+	}
+	for(list<connection>::iterator it = connections.begin(); it != connections.end(); ++it) {
+		it->server.join();
+	}
+	return true;
+}
+
+void queryserver::printLatencies(ostream& os) const {
+	vector<double> sorted;
+	{
+		lock_guard<mutex> lg(latencyLock);
+		sorted = latencies;
+	}
+	os << "Answered " << sorted.size() << " queries on " << workers.size() << " threads" << endl;
+	if(sorted.empty()) return;
+	sort(sorted.begin(), sorted.end());
+
+	static const double kPercentiles[] = {50, 90, 99, 99.9};
+	static const char *const kLabels[] = {"p50", "p90", "p99", "p99.9"};
+	os << "Latency (ms):" << fixed << setprecision(3);
+	for(unsigned i = 0; i < sizeof(kPercentiles) / sizeof(kPercentiles[0]); i++) {
+		size_t rank = (size_t) (kPercentiles[i] / 100 * sorted.size());
+		os << "  " << kLabels[i] << " " << sorted[min(rank, sorted.size() - 1)];
+	}
+	os << "  max " << sorted.back() << endl;
+	if(cache != NULL) cache->printStats(os);
+}
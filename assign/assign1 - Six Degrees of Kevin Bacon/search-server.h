@@ -0,0 +1,131 @@
+#pragma once
+#include "imdb.h"
+#include "search-engine.h"
+#include "search-cache.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * Class: queryserver
+ * ------------------
+ * Answers shortest-path queries against a long-lived imdb.  Queries
+ * arrive as newline-delimited lines of the form
+ *
+ *     <source-actor><TAB><target-actor>
+ *
+ * and each is answered with the path exactly as search prints it, followed
+ * by a blank line.  Queries from every stream are spread across a fixed pool
+ * of worker threads, each with its own searchscratch, but the answers on any
+ * one stream always come back in the order the queries were sent.  Each
+ * query runs against whichever imdb the handle held when it started, so the
+ * data can be reloaded underneath a running server.  Given a memory budget,
+ * the server also keeps a querycache of recent answers and of the search
+ * trees of popular sources.
+ */
+class queryserver {
+ public:
+
+  /**
+   * Constructor: queryserver
+   * ------------------------
+   * Starts the worker threads.
+   *
+   * @param handle the handle to the imdb to answer queries against.  It must
+   *               outlive the server.
+   * @param numThreads the number of worker threads to run queries on.
+   * @param bidirectional true if queries should use the bidirectional search.
+   * @param cacheBytes the memory budget of the querycache, or 0 for none.
+   *                   Queries answered from a cached search tree get the path
+   *                   the single-ended search finds, even under bidirectional.
+   */
+  queryserver(imdbhandle& handle, size_t numThreads, bool bidirectional, size_t cacheBytes = 0);
+
+  /**
+   * Method: serve
+   * -------------
+   * Reads queries from infd and writes answers to outfd until infd reaches
+   * end of file and every answer has been written.  Any number of threads
+   * may be in serve at once.
+   */
+  void serve(int infd, int outfd);
+
+  /**
+   * Method: serveSocket
+   * -------------------
+   * Listens on a Unix domain socket at the specified path, serving each
+   * connection on its own thread, until requestShutdown is called.  Open
+   * connections are shut down and drained before serveSocket returns.
+   * Whenever requestReload is called, the imdb is reloaded between accepts
+   * and the outcome is reported to cerr.
+   *
+   * @return false if the socket couldn't be created, and true otherwise.
+   */
+  bool serveSocket(const std::string& socketPath);
+
+  /**
+   * Static Method: requestShutdown
+   * ------------------------------
+   * Asks serveSocket to stop accepting connections and return.  Only sets a
+   * flag, so it's safe to call from a signal handler.
+   */
+  static void requestShutdown();
+
+  /**
+   * Static Method: requestReload
+   * ----------------------------
+   * Asks serveSocket to reload the imdb.  Only sets a flag, so it's safe to
+   * call from a signal handler.
+   */
+  static void requestReload();
+
+  /**
+   * Method: printLatencies
+   * ----------------------
+   * Prints the number of queries answered and percentiles of the time spent
+   * answering each one, followed by the cache's hit rates if there is one.
+   */
+  void printLatencies(std::ostream& os) const;
+
+  /**
+   * Destructor: ~queryserver
+   * ------------------------
+   * Waits for the queued queries to be answered and stops the worker threads.
+   */
+  ~queryserver();
+
+ private:
+  struct session;
+  struct job {
+    session *owner;
+    size_t sequence;
+    std::string query;
+  };
+
+  imdbhandle& handle;
+  bool bidirectional;
+  std::unique_ptr<querycache> cache;
+  std::vector<std::thread> workers;
+
+  std::mutex queueLock;
+  std::condition_variable queueChanged;
+  std::deque<job> queue;
+  bool stopping;
+
+  mutable std::mutex latencyLock;
+  std::vector<double> latencies;
+
+  void work();
+  std::string answer(const std::string& query, searchscratch& scratch) const;
+  static std::string formatAnswer(bool found, const path& p);
+  void writeAnswers(session& s);
+
+  queryserver(const queryserver& original) = delete;
+  queryserver& operator=(const queryserver& rhs) = delete;
+};
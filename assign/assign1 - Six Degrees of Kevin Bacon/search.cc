@@ -1,92 +1,212 @@
 #include <iostream>
-#include <utility>
-#include <vector>
+#include <string>
+#include <cstdlib>
+#include <climits>
+#include <thread>
+#include <getopt.h>
+#include <signal.h>
+#include <unistd.h>
 #include "path.h"
-#include <list>
-#include <set>
-#include <unordered_set>
 #include "imdb.h"
+#include "search-engine.h"
+#include "search-server.h"
 using namespace std;
 
 static const int kWrongArgumentCount = 1;
 static const int kDatabaseNotFound = 2;
+static const int kSocketUnavailable = 3;
 
-int main(int argc, char *argv[]) {
-	if (argc != 3) {
-		cerr << "Usage: " << argv[0] << " <source-actor> <target-actor>" << endl;
-		return kWrongArgumentCount;
-	}
-	imdb db(kIMDBDataDirectory);
-	if (!db.good()) {
-		cerr << "Data directory not found!  Aborting..." << endl; 
-		return kDatabaseNotFound;
-	}
-	string source = argv[1];
-	string target = argv[2];
+static void printUsage(const char *progname) {
+	cerr << "Usage: " << progname << " [--bidirectional | --parallel [--threads N]] <source-actor> <target-actor>" << endl;
+	cerr << "       " << progname << " --distance <source-actor> <target-actor>" << endl;
+	cerr << "       " << progname << " (--all | --top K) [--newest] <source-actor> <target-actor>" << endl;
+	cerr << "Any form also accepts --map <policy>, where policy is one of:";
+	for (int i = 0; i < imdb::kMapPolicyCount; i++) cerr << " " << imdb::kMapPolicyNames[i];
+	cerr << endl;
+	cerr << "       " << progname << " [--bidirectional] [--threads N] --serve [--socket path] [--cache MB]" << endl;
+}
 
-	// create a list for BFS
-	list<vector<pair<string, film>>> todo;
-	unordered_set<string> visited_actor;
-	set<film> visited_movie;
+/**
+ * Function: printShortestPaths
+ * ----------------------------
+ * Prints how many shortest paths there are from source to target, then
+ * the first limit of them (or all of them, if limit is 0), each followed
+ * by a blank line, as they're enumerated.
+ */
+static void printShortestPaths(const imdb& db, const string& source, const string& target,
+		size_t limit, pathdag::pathorder order) {
+	pathdag dag(db, source, target);
+	if (dag.getLength() == kUnreachable) {
+		cout << "No path between those two people could be found." << endl;
+		return;
+	}
+	unsigned long long count = dag.getPathCount();
+	cout << (count == ULLONG_MAX ? "At least " : "") << count << " shortest path" << (count == 1 ? "" : "s")
+		<< " of length " << dag.getLength() << (limit == 0 || limit >= count ? ":" : ", the first " +
+		to_string(limit) + ":") << endl << endl;
+	size_t printed = 0;
+	dag.forEachPath(order, [limit, &printed](const path& p) {
+		cout << p << endl;
+		return limit == 0 || ++printed < limit;
+	});
+}
 
-	// put the first element
-	film dummy_film;
-	dummy_film.title = "zhangrao";
-	dummy_film.year = 1990;
-	vector<pair<string, film>> temp_vect;
-	temp_vect.push_back(make_pair(source, dummy_film));
-	todo.push_back(temp_vect);
-	visited_actor.insert(source);
+static void handleShutdownSignal(int sig) {
+	queryserver::requestShutdown();
+}
 
-	// while loop to find the path
-	while(!todo.empty()) {
-		vector<pair<string, film>> curr_vect = todo.front();
-		pair<string, film> curr_pair = curr_vect[curr_vect.size() - 1];
-		string curr_name = curr_pair.first;
+static void handleReloadSignal(int sig) {
+	queryserver::requestReload();
+}
 
-		if(curr_name == target) {
-			break;
+/**
+ * Function: serveQueries
+ * ----------------------
+ * Keeps the imdb mapped and answers tab-separated source/target pairs read
+ * from stdin (or from every connection to the Unix domain socket, if one is
+ * named) until end of input (or SIGINT/SIGTERM), then reports latencies.
+ * When serving a socket, SIGHUP reloads the data files.  A nonzero cacheMB
+ * caches recent answers and the search trees of popular sources.
+ */
+static int serveQueries(imdb::mappolicy policy, bool bidirectional, size_t numThreads, const string& socketPath,
+		size_t cacheMB) {
+	imdbhandle handle(kIMDBDataDirectory, true, policy, true);
+	if (!handle.get()->good()) {
+		cerr << handle.get()->getError() << "!  Aborting..." << endl;
+		return kDatabaseNotFound;
+	}
+	signal(SIGPIPE, SIG_IGN);
+	queryserver server(handle, numThreads, bidirectional, cacheMB * 1024 * 1024);
+	if (socketPath.empty()) {
+		server.serve(STDIN_FILENO, STDOUT_FILENO);
+	} else {
+		struct sigaction action;
+		action.sa_handler = handleShutdownSignal;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = 0;
+		sigaction(SIGINT, &action, NULL);
+		sigaction(SIGTERM, &action, NULL);
+		action.sa_handler = handleReloadSignal;
+		sigaction(SIGHUP, &action, NULL);
+		if (!server.serveSocket(socketPath)) {
+			cerr << "Couldn't listen on \"" << socketPath << "\"!  Aborting..." << endl;
+			return kSocketUnavailable;
 		}
-		todo.pop_front();
+	}
+	server.printLatencies(cerr);
+	return 0;
+}
 
-		vector<film> neighbor_movies;
-		if(db.getCredits(curr_name, neighbor_movies)) {
-			for(unsigned i = 0; i < neighbor_movies.size(); i++) {
-				film neighbor_movie = neighbor_movies[i];
-				if(visited_movie.count(neighbor_movie)) {
-					continue;
-				} else {
-					visited_movie.insert(neighbor_movie);
-				}
-				vector<string> neighbor_actors;
-				if(db.getCast(neighbor_movie, neighbor_actors)) {
-					for(unsigned j = 0; j < neighbor_actors.size(); j++) {
-						string neighbor_actor = neighbor_actors[j];
-						if(visited_actor.count(neighbor_actor)) {
-							continue;
-						} else {// many things to do
-							visited_actor.insert(neighbor_actor);
-							vector<pair<string, film>> copy = curr_vect;
-							pair<string, film> temp_pair = make_pair(neighbor_actor, neighbor_movie);
-							copy.push_back(temp_pair);
-							todo.push_back(copy);
-						}
-					}
-				}
+int main(int argc, char *argv[]) {
+	static const struct option kLongOptions[] = {
+		{"bidirectional", no_argument, NULL, 'b'},
+		{"parallel", no_argument, NULL, 'p'},
+		{"distance", no_argument, NULL, 'd'},
+		{"all", no_argument, NULL, 'a'},
+		{"top", required_argument, NULL, 'k'},
+		{"newest", no_argument, NULL, 'n'},
+		{"map", required_argument, NULL, 'm'},
+		{"serve", no_argument, NULL, 's'},
+		{"socket", required_argument, NULL, 'u'},
+		{"cache", required_argument, NULL, 'c'},
+		{"threads", required_argument, NULL, 't'},
+		{NULL, 0, NULL, 0}
+	};
+	bool bidirectional = false;
+	bool parallel = false;
+	bool distanceOnly = false;
+	bool allPaths = false;
+	size_t topPaths = 0;
+	pathdag::pathorder order = pathdag::kTitleOrder;
+	imdb::mappolicy policy = imdb::kMapPlain;
+	bool serve = false;
+	string socketPath;
+	size_t cacheMB = 0;
+	size_t numThreads = max(thread::hardware_concurrency(), 1u);
+	int opt;
+	while ((opt = getopt_long(argc, argv, "bpdak:nm:su:c:t:", kLongOptions, NULL)) != -1) {
+		switch (opt) {
+		case 'b':
+			bidirectional = true;
+			break;
+		case 'p':
+			parallel = true;
+			break;
+		case 'd':
+			distanceOnly = true;
+			break;
+		case 'a':
+			allPaths = true;
+			break;
+		case 'k':
+			topPaths = max(atoi(optarg), 0);
+			if (topPaths == 0) {
+				printUsage(argv[0]);
+				return kWrongArgumentCount;
+			}
+			break;
+		case 'n':
+			order = pathdag::kNewestFirst;
+			break;
+		case 'm':
+			if (!imdb::parseMapPolicy(optarg, policy)) {
+				printUsage(argv[0]);
+				return kWrongArgumentCount;
 			}
+			break;
+		case 's':
+			serve = true;
+			break;
+		case 'u':
+			socketPath = optarg;
+			break;
+		case 'c':
+			cacheMB = max(atoi(optarg), 0);
+			break;
+		case 't':
+			numThreads = max(atoi(optarg), 0);
+			break;
+		default:
+			printUsage(argv[0]);
+			return kWrongArgumentCount;
 		}
 	}
-	if(todo.empty() || todo.front().empty()) {
+	if (argc - optind != (serve ? 0 : 2) || numThreads < 1 || ((!socketPath.empty() || cacheMB > 0) && !serve) ||
+		(parallel && (bidirectional || serve)) || (distanceOnly && (parallel || bidirectional || serve)) ||
+		((allPaths || topPaths > 0) && (allPaths == (topPaths > 0) || distanceOnly || parallel || bidirectional || serve)) ||
+		(order == pathdag::kNewestFirst && !allPaths && topPaths == 0)) {
+		printUsage(argv[0]);
+		return kWrongArgumentCount;
+	}
+	if (serve) return serveQueries(policy, bidirectional, numThreads, socketPath, cacheMB);
+	imdb db(kIMDBDataDirectory, true, policy);
+	if (!db.good()) {
+		cerr << db.getError() << "!  Aborting..." << endl;
+		return kDatabaseNotFound;
+	}
+
+	string source = argv[optind];
+	string target = argv[optind + 1];
+	if (allPaths || topPaths > 0) {
+		printShortestPaths(db, source, target, topPaths, order);
+		return 0;
+	}
+	if (distanceOnly) {
+		int distance = findDistance(db, source, target);
+		if (distance == kUnreachable) cout << "No path between those two people could be found." << endl;
+		else cout << distance << endl;
+		return 0;
+	}
+
+	path p(source);
+	bool found;
+	if (parallel) found = findShortestPathParallel(db, source, target, p, numThreads);
+	else if (bidirectional) found = findShortestPathBidirectional(db, source, target, p);
+	else found = findShortestPath(db, source, target, p);
+	if(!found) {
 		cout << "No path between those two people could be found." << endl;
 	} else {
-		// print the path
-		vector<pair<string, film>> vec = todo.front();
-		path p(vec[0].first);
-		for(unsigned i = 1; i < vec.size(); i++) {
-			p.addConnection(vec[i].second, vec[i].first);	
-		}
 		cout << p;
 	}
 	return 0;
 }
-
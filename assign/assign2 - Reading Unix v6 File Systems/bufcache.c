@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bufcache.h"
+#include "diskimg.h"
+
+#define NO_SLOT (-1)
+
+static int hashsector(const struct bufcache *cache, int sectorNum) {
+  return (unsigned int) sectorNum * 2654435761u % cache->numBuckets;
+}
+
+static int findslot(const struct bufcache *cache, int sectorNum) {
+  int slot = cache->buckets[hashsector(cache, sectorNum)];
+  while (slot != NO_SLOT && cache->sectors[slot] != sectorNum) slot = cache->chain[slot];
+  return slot;
+}
+
+static void unlinkslot(struct bufcache *cache, int slot) {
+  if (cache->newer[slot] == NO_SLOT) cache->mru = cache->older[slot];
+  else cache->older[cache->newer[slot]] = cache->older[slot];
+  if (cache->older[slot] == NO_SLOT) cache->lru = cache->newer[slot];
+  else cache->newer[cache->older[slot]] = cache->newer[slot];
+}
+
+static void pushslot(struct bufcache *cache, int slot) {
+  cache->newer[slot] = NO_SLOT;
+  cache->older[slot] = cache->mru;
+  if (cache->mru == NO_SLOT) cache->lru = slot;
+  else cache->newer[cache->mru] = slot;
+  cache->mru = slot;
+}
+
+static void unhashslot(struct bufcache *cache, int slot) {
+  int *link = &cache->buckets[hashsector(cache, cache->sectors[slot])];
+  while (*link != slot) link = &cache->chain[*link];
+  *link = cache->chain[slot];
+}
+
+static void hashslot(struct bufcache *cache, int slot) {
+  int *bucket = &cache->buckets[hashsector(cache, cache->sectors[slot])];
+  cache->chain[slot] = *bucket;
+  *bucket = slot;
+}
+
+struct bufcache *bufcache_create(int dfd, int numSlots) {
+  if (numSlots <= 0) return NULL;
+  struct bufcache *cache = calloc(1, sizeof(struct bufcache));
+  if (cache == NULL) return NULL;
+
+  cache->dfd = dfd;
+  cache->numSlots = numSlots;
+  cache->numBuckets = 2 * numSlots;
+  cache->data = malloc((size_t) numSlots * DISKIMG_SECTOR_SIZE);
+  cache->sectors = malloc(numSlots * sizeof(int));
+  cache->newer = malloc(numSlots * sizeof(int));
+  cache->older = malloc(numSlots * sizeof(int));
+  cache->chain = malloc(numSlots * sizeof(int));
+  cache->buckets = malloc(cache->numBuckets * sizeof(int));
+  if (cache->data == NULL || cache->sectors == NULL || cache->newer == NULL ||
+      cache->older == NULL || cache->chain == NULL || cache->buckets == NULL) {
+    bufcache_free(cache);
+    return NULL;
+  }
+  for (int i = 0; i < cache->numBuckets; i++) cache->buckets[i] = NO_SLOT;
+  cache->mru = cache->lru = NO_SLOT;
+  return cache;
+}
+
+int bufcache_readsector(struct bufcache *cache, int sectorNum, void *buf) {
+  int slot = findslot(cache, sectorNum);
+  if (slot != NO_SLOT) {
+    cache->hits++;
+    unlinkslot(cache, slot);
+    pushslot(cache, slot);
+    memcpy(buf, cache->data + (size_t) slot * DISKIMG_SECTOR_SIZE, DISKIMG_SECTOR_SIZE);
+    return DISKIMG_SECTOR_SIZE;
+  }
+
+  cache->misses++;
+  int bytesRead = diskimg_readsector(cache->dfd, sectorNum, buf);
+  if (bytesRead != DISKIMG_SECTOR_SIZE) return bytesRead;
+
+  // take a free slot while there are any, and the least recently used one after that
+  if (cache->numUsed < cache->numSlots) {
+    slot = cache->numUsed++;
+  } else {
+    slot = cache->lru;
+    unlinkslot(cache, slot);
+    unhashslot(cache, slot);
+  }
+  cache->sectors[slot] = sectorNum;
+  hashslot(cache, slot);
+  pushslot(cache, slot);
+  memcpy(cache->data + (size_t) slot * DISKIMG_SECTOR_SIZE, buf, DISKIMG_SECTOR_SIZE);
+  return bytesRead;
+}
+
+void bufcache_free(struct bufcache *cache) {
+  if (cache == NULL) return;
+  free(cache->data);
+  free(cache->sectors);
+  free(cache->newer);
+  free(cache->older);
+  free(cache->chain);
+  free(cache->buckets);
+  free(cache);
+}
@@ -0,0 +1,45 @@
+#ifndef _BUFCACHE_H_
+#define _BUFCACHE_H_
+
+/**
+ * A cache of recently read sectors of one disk image, evicted least recently
+ * used first.  It sits under diskimg_readsector() for images that are read
+ * with system calls, so that the sectors read over and over (the inode
+ * sectors and the indirect blocks) only cost one read each.
+ */
+struct bufcache {
+  int dfd;          // Handle from the diskimg module of the image cached.
+  int numSlots;     // Number of sectors the cache can hold.
+  int numUsed;      // Number of slots holding a sector.
+  char *data;       // The sectors, DISKIMG_SECTOR_SIZE bytes per slot.
+  int *sectors;     // The sector held by each slot.
+  int *newer;       // The LRU list of slots, threaded through these two
+  int *older;       // arrays, from mru (most recent) to lru.
+  int mru, lru;
+  int *buckets;     // Hash chains of slots, by sector number.
+  int *chain;
+  int numBuckets;
+  long hits;        // Reads answered from the cache.
+  long misses;      // Reads passed on to diskimg_readsector().
+};
+
+/**
+ * Allocates a cache of numSlots sectors for the image open on dfd.  Returns
+ * NULL if numSlots isn't positive or there isn't enough memory.
+ */
+struct bufcache *bufcache_create(int dfd, int numSlots);
+
+/**
+ * Reads the specified sector into buf, from the cache if it's there and from
+ * the disk image (remembering it) if not.  Returns the number of bytes read,
+ * or -1 on error, just as diskimg_readsector() does.  Short reads and errors
+ * aren't cached.
+ */
+int bufcache_readsector(struct bufcache *cache, int sectorNum, void *buf);
+
+/**
+ * Frees the cache.  The disk image isn't closed.
+ */
+void bufcache_free(struct bufcache *cache);
+
+#endif // _BUFCACHE_H_
@@ -13,6 +13,9 @@
 #include "chksumfile.h"
 #include <openssl/sha.h>
 
+// How much of a file is read at a time.
+#define CHKSUMFILE_READ_SIZE (64 * DISKIMG_SECTOR_SIZE)
+
 int chksumfile_byinumber(struct unixfilesystem *fs, int inumber, void *chksum) {
   SHA_CTX shactx;
   if (!SHA1_Init(&shactx)) {
@@ -31,18 +34,24 @@ int chksumfile_byinumber(struct unixfilesystem *fs, int inumber, void *chksum) {
     return -1;
   }
 
-  int size = inode_getsize(&in);
-  for (int offset = 0; offset < size; offset += DISKIMG_SECTOR_SIZE) {
-    char buf[DISKIMG_SECTOR_SIZE];
-    int bno = offset/DISKIMG_SECTOR_SIZE;
-
-    int bytesMoved = file_getblock(fs, inumber, bno, buf);
-    if (bytesMoved < 0)
-      return -1;
+  // Read the file in large pieces, so that runs of consecutive blocks take a
+  // single read of the disk image.
+  struct v6file *file = file_open(fs, inumber);
+  if (file == NULL) {
+    return -1;
+  }
 
-    if (!SHA1_Update(&shactx, buf, bytesMoved))
+  int size = inode_getsize(&in);
+  for (int offset = 0; offset < size; ) {
+    char buf[CHKSUMFILE_READ_SIZE];
+    int bytesMoved = file_read(file, offset, buf, sizeof(buf));
+    if (bytesMoved <= 0 || !SHA1_Update(&shactx, buf, bytesMoved)) {
+      file_close(file);
       return -1;
+    }
+    offset += bytesMoved;
   }
+  file_close(file);
 
   if (!SHA1_Final(chksum, &shactx))
     return -1;
@@ -0,0 +1,142 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dircache.h"
+
+#define NO_ENTRY (-1)
+
+// States of the directories in cache->dirs.
+#define DIR_UNSEEN   0
+#define DIR_INDEXED  1
+#define DIR_SKIPPED  2
+
+static unsigned int hashname(int dirinumber, const char *name, int nameLen) {
+  unsigned int hash = 2166136261u ^ (unsigned int) dirinumber;
+  for (int i = 0; i < nameLen; i++) {
+    hash = (hash ^ (unsigned char) name[i]) * 16777619u;
+  }
+  return hash;
+}
+
+static int findentry(const struct dircache *cache, int dirinumber, const char *name, int nameLen) {
+  unsigned int bucket = hashname(dirinumber, name, nameLen) & (cache->numBuckets - 1);
+  for (int e = cache->buckets[bucket]; e != NO_ENTRY; e = cache->entries[e].next) {
+    const struct dircacheentry *entry = &cache->entries[e];
+    if (entry->dirinumber == dirinumber && entry->nameLen == nameLen &&
+        memcmp(entry->dirent.d_name, name, nameLen) == 0) {
+      return e;
+    }
+  }
+  return NO_ENTRY;
+}
+
+static void hashentry(struct dircache *cache, int e) {
+  struct dircacheentry *entry = &cache->entries[e];
+  unsigned int bucket = hashname(entry->dirinumber, entry->dirent.d_name, entry->nameLen) &
+                        (cache->numBuckets - 1);
+  entry->next = cache->buckets[bucket];
+  cache->buckets[bucket] = e;
+}
+
+/**
+ * Makes room for numEntries more entries, doubling the entries and the hash
+ * buckets as needed so that the chains stay about one entry long.
+ */
+static int reserve(struct dircache *cache, int numEntries) {
+  int needed = cache->numEntries + numEntries;
+  if (needed <= cache->maxEntries) return 0;
+
+  int maxEntries = cache->maxEntries;
+  while (maxEntries < needed) maxEntries *= 2;
+  struct dircacheentry *entries = realloc(cache->entries, maxEntries * sizeof(struct dircacheentry));
+  if (entries == NULL) return -1;
+  cache->entries = entries;
+  cache->maxEntries = maxEntries;
+
+  int *buckets = malloc(maxEntries * sizeof(int));
+  if (buckets == NULL) return -1;
+  free(cache->buckets);
+  cache->buckets = buckets;
+  cache->numBuckets = maxEntries;
+  for (int b = 0; b < cache->numBuckets; b++) cache->buckets[b] = NO_ENTRY;
+  for (int e = 0; e < cache->numEntries; e++) hashentry(cache, e);
+  return 0;
+}
+
+struct dircache *dircache_create(int numInodes) {
+  if (numInodes < 0) return NULL;
+  struct dircache *cache = calloc(1, sizeof(struct dircache));
+  if (cache == NULL) return NULL;
+
+  cache->numInodes = numInodes;
+  cache->dirs = calloc(numInodes + 1, sizeof(signed char));
+  cache->maxEntries = cache->numBuckets = 256;
+  cache->entries = malloc(cache->maxEntries * sizeof(struct dircacheentry));
+  cache->buckets = malloc(cache->numBuckets * sizeof(int));
+  if (cache->dirs == NULL || cache->entries == NULL || cache->buckets == NULL) {
+    dircache_free(cache);
+    return NULL;
+  }
+  for (int b = 0; b < cache->numBuckets; b++) cache->buckets[b] = NO_ENTRY;
+  return cache;
+}
+
+int dircache_lookup(struct dircache *cache, int dirinumber, const char *name,
+                    struct direntv6 *dirEnt) {
+  if (dirinumber < 1 || dirinumber > cache->numInodes) {
+    cache->misses++;
+    return DIRCACHE_UNCACHED;
+  }
+  if (cache->dirs[dirinumber] == DIR_UNSEEN) return DIRCACHE_UNINDEXED;
+
+  int nameLen = strnlen(name, DIRCACHE_MAX_NAME);
+  if (cache->dirs[dirinumber] == DIR_SKIPPED || nameLen == DIRCACHE_MAX_NAME) {
+    cache->misses++;
+    return DIRCACHE_UNCACHED;
+  }
+
+  cache->hits++;
+  int e = findentry(cache, dirinumber, name, nameLen);
+  if (e == NO_ENTRY) return DIRCACHE_ABSENT;
+  *dirEnt = cache->entries[e].dirent;
+  return DIRCACHE_FOUND;
+}
+
+int dircache_adddir(struct dircache *cache, int dirinumber,
+                    const struct direntv6 *entries, int numEntries) {
+  if (dirinumber < 1 || dirinumber > cache->numInodes) return -1;
+  if (cache->dirs[dirinumber] != DIR_UNSEEN) return 0;
+  if (reserve(cache, numEntries) < 0) {
+    cache->dirs[dirinumber] = DIR_SKIPPED;
+    return -1;
+  }
+
+  for (int i = 0; i < numEntries; i++) {
+    int nameLen = strnlen(entries[i].d_name, DIRCACHE_MAX_NAME);
+    // Names that fill d_name are never looked up here, and a repeated name
+    // is found at its first entry.
+    if (nameLen == DIRCACHE_MAX_NAME) continue;
+    if (findentry(cache, dirinumber, entries[i].d_name, nameLen) != NO_ENTRY) continue;
+
+    int e = cache->numEntries++;
+    cache->entries[e].dirent = entries[i];
+    cache->entries[e].dirinumber = dirinumber;
+    cache->entries[e].nameLen = nameLen;
+    hashentry(cache, e);
+  }
+  cache->dirs[dirinumber] = DIR_INDEXED;
+  return 0;
+}
+
+void dircache_skipdir(struct dircache *cache, int dirinumber) {
+  if (dirinumber < 1 || dirinumber > cache->numInodes) return;
+  cache->dirs[dirinumber] = DIR_SKIPPED;
+}
+
+void dircache_free(struct dircache *cache) {
+  if (cache == NULL) return;
+  free(cache->dirs);
+  free(cache->entries);
+  free(cache->buckets);
+  free(cache);
+}
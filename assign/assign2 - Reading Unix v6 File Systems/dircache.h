@@ -0,0 +1,78 @@
+#ifndef _DIRCACHE_H_
+#define _DIRCACHE_H_
+
+#include "direntv6.h"
+
+/**
+ * An index of the directory entries of one filesystem, by directory inumber
+ * and name, so that directory_findname() can look a name up without scanning
+ * the directory.  A directory is indexed whole, the first time a name is
+ * looked up in it, and from then on a name missing from the index is known
+ * not to be in the directory.
+ *
+ * Only names shorter than DIRCACHE_MAX_NAME are indexed.  A longer name fills
+ * the whole d_name field with no terminating NUL, and is left to the scan.
+ */
+#define DIRCACHE_MAX_NAME 14
+
+// Results of dircache_lookup().
+#define DIRCACHE_FOUND       1   // The name is in the directory.
+#define DIRCACHE_ABSENT      0   // The name isn't in the directory.
+#define DIRCACHE_UNINDEXED (-1)  // The directory hasn't been indexed yet.
+#define DIRCACHE_UNCACHED  (-2)  // The cache can't say; scan the directory.
+
+struct dircacheentry {
+  struct direntv6 dirent;  // The entry, as read from the directory.
+  int dirinumber;          // The directory it's in.
+  int nameLen;             // Length of its name.
+  int next;                // Next entry in the same hash chain, or -1.
+};
+
+struct dircache {
+  int numInodes;                  // Largest inumber that can be indexed.
+  signed char *dirs;              // State of each directory, by inumber.
+  struct dircacheentry *entries;
+  int numEntries;
+  int maxEntries;
+  int *buckets;                   // Hash chains of entries, by directory and name.
+  int numBuckets;                 // Always a power of two.
+  long hits;                      // Lookups answered from the index.
+  long misses;                    // Lookups left to a scan.
+};
+
+/**
+ * Allocates an empty index for a filesystem with numInodes inodes.  Returns
+ * NULL if there isn't enough memory.
+ */
+struct dircache *dircache_create(int numInodes);
+
+/**
+ * Looks up the specified name in directory dirinumber, filling in *dirEnt
+ * when it's found.  Returns one of the DIRCACHE_ results above.  When a
+ * directory holds several entries with the same name, the first one is the
+ * one found, just as with a scan.
+ */
+int dircache_lookup(struct dircache *cache, int dirinumber, const char *name,
+                    struct direntv6 *dirEnt);
+
+/**
+ * Indexes directory dirinumber, which holds the numEntries entries given, in
+ * order.  numEntries may be 0 for a directory no name can be found in.
+ * Returns -1 if there isn't enough memory, in which case the directory is
+ * left to be scanned.
+ */
+int dircache_adddir(struct dircache *cache, int dirinumber,
+                    const struct direntv6 *entries, int numEntries);
+
+/**
+ * Marks directory dirinumber as one that can't be indexed (because it
+ * couldn't all be read), so its lookups are always left to a scan.
+ */
+void dircache_skipdir(struct dircache *cache, int dirinumber);
+
+/**
+ * Frees the index.
+ */
+void dircache_free(struct dircache *cache);
+
+#endif // _DIRCACHE_H_
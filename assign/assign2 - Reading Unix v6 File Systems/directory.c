@@ -2,16 +2,57 @@
 #include "inode.h"
 #include "diskimg.h"
 #include "file.h"
+#include "dircache.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
+/**
+ * Reads the whole of the specified directory into the name index.  Something
+ * that isn't a directory, or is empty, is indexed as having no names, since
+ * directory_findname() never finds any in it; a directory that can't all be
+ * read is left to be scanned, so that it fails the same way as before.
+ */
+static void index_directory(struct unixfilesystem *fs, int dirinumber) {
+	struct inode my_node;
+	int err = inode_iget(fs, dirinumber, &my_node);
+	if(err < 0 || (my_node.i_mode & IFMT) != IFDIR) {
+		dircache_adddir(fs->names, dirinumber, NULL, 0);
+		return;
+	}
+
+	// read all the entries at once, a run of consecutive blocks at a time
+	int entry_num = inode_getsize(&my_node) / sizeof(struct direntv6);
+	int entry_bytes = entry_num * sizeof(struct direntv6);
+	struct direntv6 *entries = malloc(entry_bytes + sizeof(struct direntv6));
+	struct v6file *file = (entries == NULL) ? NULL : file_open(fs, dirinumber);
+	if(file != NULL && file_read(file, 0, entries, entry_bytes) == entry_bytes) {
+		dircache_adddir(fs->names, dirinumber, entries, entry_num);
+	} else {
+		dircache_skipdir(fs->names, dirinumber);
+	}
+	file_close(file);
+	free(entries);
+}
+
 /**
  * Looks up the specified name (name) in the specified directory (dirinumber).  
  * If found, return the directory entry in space addressed by dirEnt.  Returns 0 
  * on success and something negative on failure. 
  */
 int directory_findname(struct unixfilesystem *fs, const char *name, int dirinumber, struct direntv6 *dirEnt) {
+	// answer from the name index when it can, indexing the directory the first time
+	if(fs->names != NULL) {
+		int found = dircache_lookup(fs->names, dirinumber, name, dirEnt);
+		if(found == DIRCACHE_UNINDEXED) {
+			index_directory(fs, dirinumber);
+			found = dircache_lookup(fs->names, dirinumber, name, dirEnt);
+		}
+		if(found == DIRCACHE_FOUND) return 0;
+		if(found == DIRCACHE_ABSENT) return -1;
+	}
+
 	// get inode information
 	struct inode my_node;
 	int err = inode_iget(fs, dirinumber, &my_node);
@@ -28,10 +69,13 @@ int directory_findname(struct unixfilesystem *fs, const char *name, int dirinumb
 
 	// loop block, then loop entries
 	int total_block_num = (dir_size - 1) / DISKIMG_SECTOR_SIZE + 1;
-	for(int i = 0; i < total_block_num; i++) {		// check all blocks
-		struct direntv6 entries[DISKIMG_SECTOR_SIZE / sizeof(struct direntv6)];
-		int valid_bytes = file_getblock(fs, dirinumber, i, entries);
-		if(valid_bytes < 0) return -1;
+	for(int i = 0; i < total_block_num; i++) {		// check all blocks, in place if the image is mapped
+		int sector = inode_indexlookup(fs, &my_node, i);
+		if(sector < 0) return -1;
+		struct direntv6 buf[DISKIMG_SECTOR_SIZE / sizeof(struct direntv6)];
+		const struct direntv6 *entries = unixfilesystem_getsector(fs, sector, buf);
+		if(entries == NULL) return -1;
+		int valid_bytes = (i == total_block_num - 1) ? dir_size - i * DISKIMG_SECTOR_SIZE : DISKIMG_SECTOR_SIZE;
 		int total_entry_num = valid_bytes / sizeof(struct direntv6);
 		for(int j = 0; j < total_entry_num; j++) {	// check all valid entries in a block
 			int cmp = strcmp(entries[j].d_name, name);
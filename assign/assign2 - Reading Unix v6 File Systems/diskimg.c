@@ -1,31 +1,147 @@
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "diskimg.h"
 
+/**
+ * The memory-mapped images, indexed by file descriptor.  An image that
+ * couldn't be mapped (or was unmapped) has a NULL base, and is read with
+ * system calls instead.
+ */
+struct mapping {
+  char *base;
+  size_t size;
+};
+
+// Well under the IOV_MAX of any system with preadv().
+#define SECTORS_PER_PREADV 256
+
+static struct mapping *mappings = NULL;
+static int numMappings = 0;
+
+static struct mapping *findmapping(int fd) {
+  if (fd < 0 || fd >= numMappings || mappings[fd].base == NULL) return NULL;
+  return &mappings[fd];
+}
+
+/**
+ * Maps the whole image read-only.  The mapping is shared, so it sees every
+ * diskimg_writesector() made through the descriptor.  Failing to map isn't
+ * an error: reads just fall back to system calls.
+ */
+static void mapimage(int fd) {
+  struct stat st;
+  if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size == 0) return;
+  if (fd >= numMappings) {
+    struct mapping *grown = realloc(mappings, (fd + 1) * sizeof(struct mapping));
+    if (grown == NULL) return;
+    memset(grown + numMappings, 0, (fd + 1 - numMappings) * sizeof(struct mapping));
+    mappings = grown;
+    numMappings = fd + 1;
+  }
+  void *base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) return;
+  mappings[fd].base = base;
+  mappings[fd].size = st.st_size;
+}
+
 int diskimg_open(char *pathname, int readOnly) {
-  return open(pathname, readOnly ? O_RDONLY : O_RDWR);
+  int fd = open(pathname, readOnly ? O_RDONLY : O_RDWR);
+  if (fd >= 0) mapimage(fd);
+  return fd;
 }
 
 int diskimg_getsize(int fd) {
   return lseek(fd, 0, SEEK_END);
 }
 
+const void *diskimg_sectorptr(int fd, int sectorNum) {
+  struct mapping *m = findmapping(fd);
+  if (m == NULL || sectorNum < 0) return NULL;
+  size_t offset = (size_t) sectorNum * DISKIMG_SECTOR_SIZE;
+  if (offset + DISKIMG_SECTOR_SIZE > m->size) return NULL;
+  return m->base + offset;
+}
+
 int diskimg_readsector(int fd, int sectorNum,  void *buf) {
-  if (lseek(fd, sectorNum * DISKIMG_SECTOR_SIZE, SEEK_SET) == (off_t) -1) return -1;  
-  return read(fd, buf, DISKIMG_SECTOR_SIZE);
+  const void *sector = diskimg_sectorptr(fd, sectorNum);
+  if (sector != NULL) {
+    memcpy(buf, sector, DISKIMG_SECTOR_SIZE);
+    return DISKIMG_SECTOR_SIZE;
+  }
+
+  return pread(fd, buf, DISKIMG_SECTOR_SIZE, (off_t) sectorNum * DISKIMG_SECTOR_SIZE);
 }
 
-int diskimg_writesector(int fd, int sectorNum,  void *buf) {
-  if (lseek(fd, sectorNum * DISKIMG_SECTOR_SIZE, SEEK_SET) == (off_t) -1) {
-    return -1;
+int diskimg_readsectors(int fd, int startSector, int count, void *buf) {
+  if (startSector < 0 || count < 0) return -1;
+  struct mapping *m = findmapping(fd);
+  size_t offset = (size_t) startSector * DISKIMG_SECTOR_SIZE;
+  size_t length = (size_t) count * DISKIMG_SECTOR_SIZE;
+  if (m != NULL && offset + length <= m->size) {
+    memcpy(buf, m->base + offset, length);
+    return length;
+  }
+
+  size_t done = 0;
+  while (done < length) {
+    ssize_t n = pread(fd, (char *) buf + done, length - done, offset + done);
+    if (n < 0) return -1;
+    if (n == 0) break;
+    done += n;
+  }
+  return done;
+}
+
+int diskimg_readsectorsv(int fd, int startSector, int count, void *bufs[]) {
+  if (startSector < 0 || count < 0) return -1;
+  struct mapping *m = findmapping(fd);
+  size_t offset = (size_t) startSector * DISKIMG_SECTOR_SIZE;
+  size_t length = (size_t) count * DISKIMG_SECTOR_SIZE;
+  if (m != NULL && offset + length <= m->size) {
+    for (int i = 0; i < count; i++) {
+      memcpy(bufs[i], m->base + offset + (size_t) i * DISKIMG_SECTOR_SIZE, DISKIMG_SECTOR_SIZE);
+    }
+    return length;
   }
 
-  return write(fd, buf, DISKIMG_SECTOR_SIZE);
+  // one preadv per SECTORS_PER_PREADV sectors, stopping early at the end of the image
+  size_t done = 0;
+  for (int first = 0; first < count; first += SECTORS_PER_PREADV) {
+    int numVecs = count - first < SECTORS_PER_PREADV ? count - first : SECTORS_PER_PREADV;
+    struct iovec vecs[numVecs];
+    for (int i = 0; i < numVecs; i++) {
+      vecs[i].iov_base = bufs[first + i];
+      vecs[i].iov_len = DISKIMG_SECTOR_SIZE;
+    }
+    ssize_t n = preadv(fd, vecs, numVecs, offset + done);
+    if (n < 0) return -1;
+    done += n;
+    if (n < (ssize_t) numVecs * DISKIMG_SECTOR_SIZE) break;
+  }
+  return done;
+}
+
+int diskimg_writesector(int fd, int sectorNum,  void *buf) {
+  return pwrite(fd, buf, DISKIMG_SECTOR_SIZE, (off_t) sectorNum * DISKIMG_SECTOR_SIZE);
+}
+
+int diskimg_unmap(int fd) {
+  struct mapping *m = findmapping(fd);
+  if (m == NULL) return 0;
+  int err = munmap(m->base, m->size);
+  m->base = NULL;
+  m->size = 0;
+  return err;
 }
 
 int diskimg_close(int fd) {
+  if (diskimg_unmap(fd) < 0) return -1;
   return close(fd);
 }
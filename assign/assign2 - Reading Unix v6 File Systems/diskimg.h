@@ -8,7 +8,8 @@
 
 /**
  * Opens a disk image for I/O. Returns an open file descriptor, or -1 if
- * unsuccessful.  
+ * unsuccessful.  The image is also memory-mapped when possible, so that
+ * reads don't need system calls.
  */
 int diskimg_open(char *pathname, int readOnly);
 
@@ -19,16 +20,48 @@ int diskimg_getsize(int fd);
 
 /**
  * Reads the specified sector (e.g. block) from the disk.  Returns the number of bytes read,
- * or -1 on error.
+ * or -1 on error.  Reads are positioned (they never move the file offset), so
+ * any number of threads may read the same image at once.
  */
 int diskimg_readsector(int fd, int sectorNum, void *buf); 
 
+/**
+ * Reads count consecutive sectors, starting with startSector, into buf.  Returns
+ * the number of bytes read, which is less than count * DISKIMG_SECTOR_SIZE only
+ * at the end of the image, or -1 on error.
+ */
+int diskimg_readsectors(int fd, int startSector, int count, void *buf);
+
+/**
+ * Reads count consecutive sectors, starting with startSector, scattering them
+ * across the buffers in bufs: sector startSector + i goes to bufs[i], which
+ * must hold DISKIMG_SECTOR_SIZE bytes.  An unmapped image is read with a
+ * single preadv() for every 256 sectors.  Returns the number of bytes
+ * read, which is short only at the end of the image, or -1 on error.
+ */
+int diskimg_readsectorsv(int fd, int startSector, int count, void *bufs[]);
+
+/**
+ * Returns a pointer to the specified sector within the memory-mapped image, or
+ * NULL if the image isn't mapped or the sector lies past its end, in which case
+ * the caller should fall back to diskimg_readsector().  The pointer is
+ * read-only and valid until the image is unmapped or closed.
+ */
+const void *diskimg_sectorptr(int fd, int sectorNum);
+
 /**
  * Writes the specified sector from the disk.  Returns the number of bytes
  * written, or -1 on error.
  */
 int diskimg_writesector(int fd, int sectorNum, void *buf); 
 
+/**
+ * Drops the memory mapping of the image, so that every later read is made
+ * with system calls.  Returns 0 on success (or if the image wasn't mapped),
+ * or -1 on error.
+ */
+int diskimg_unmap(int fd);
+
 /**
  * Clean up from a previous diskimg_open() call.  Returns 0 on success, or -1 on
  * error.
@@ -1,5 +1,7 @@
 #include <stdio.h>
 #include <assert.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "file.h"
 #include "inode.h"
@@ -19,9 +21,10 @@ int file_getblock(struct unixfilesystem *fs, int inumber, int blockNum, void *bu
 	int sector = inode_indexlookup(fs, &my_inode, blockNum);
 	if(sector < 0) return -1;
 
-	// get block content
-	int read_err = diskimg_readsector(fs->dfd, sector, buf);
-	if(read_err < 0) return -1;
+	// get block content, copying it out of the mapped image if there is one
+	const void *block = unixfilesystem_getsector(fs, sector, buf);
+	if(block == NULL) return -1;
+	if(block != buf) memcpy(buf, block, DISKIMG_SECTOR_SIZE);
 
 	// get bytes and blocks
 	int total_bytes = inode_getsize(&my_inode);
@@ -33,3 +36,128 @@ int file_getblock(struct unixfilesystem *fs, int inumber, int blockNum, void *bu
 		return DISKIMG_SECTOR_SIZE;
 	}
 }
+
+#define INDIR_ADDR 7
+#define ADDRS_PER_SECTOR (DISKIMG_SECTOR_SIZE / sizeof(uint16_t))
+#define FILE_MAX_RUN 256	// the most sectors file_read reads at once
+
+/**
+ * Copies count sector numbers out of the indirect block in the specified
+ * sector.  Returns 0 on success, -1 on error.
+ */
+static int read_indirect(struct unixfilesystem *fs, int sector, uint16_t *sectors, int count) {
+	uint16_t buf[ADDRS_PER_SECTOR];
+	const uint16_t *addrs = unixfilesystem_getsector(fs, sector, buf);
+	if(addrs == NULL) return -1;
+	memcpy(sectors, addrs, count * sizeof(uint16_t));
+	return 0;
+}
+
+/**
+ * Works out the sector holding every block of the file, the way
+ * inode_indexlookup() does for one block, but reading each indirect block
+ * only once.  Returns 0 on success, -1 on error.
+ */
+static int build_blockmap(struct v6file *file) {
+	struct inode *inp = &file->inode;
+	int remaining = file->numBlocks;
+	uint16_t *sectors = file->sectors;
+
+	// if it is a small file
+	if((inp->i_mode & ILARG) == 0) {
+		if(remaining > INDIR_ADDR + 1) return -1;
+		memcpy(sectors, inp->i_addr, remaining * sizeof(uint16_t));
+		return 0;
+	}
+
+	// if it is a large file, the singly indirect blocks come first
+	for(int i = 0; i < INDIR_ADDR && remaining > 0; i++) {
+		int count = remaining < (int) ADDRS_PER_SECTOR ? remaining : (int) ADDRS_PER_SECTOR;
+		if(read_indirect(file->fs, inp->i_addr[i], sectors, count) < 0) return -1;
+		sectors += count;
+		remaining -= count;
+	}
+	if(remaining == 0) return 0;
+
+	// then the doubly indirect one
+	int indirect_num = (remaining - 1) / ADDRS_PER_SECTOR + 1;
+	if(indirect_num > (int) ADDRS_PER_SECTOR) return -1;
+	uint16_t indirects[ADDRS_PER_SECTOR];
+	if(read_indirect(file->fs, inp->i_addr[INDIR_ADDR], indirects, indirect_num) < 0) return -1;
+	for(int i = 0; i < indirect_num; i++) {
+		int count = remaining < (int) ADDRS_PER_SECTOR ? remaining : (int) ADDRS_PER_SECTOR;
+		if(read_indirect(file->fs, indirects[i], sectors, count) < 0) return -1;
+		sectors += count;
+		remaining -= count;
+	}
+	return 0;
+}
+
+struct v6file *file_open(struct unixfilesystem *fs, int inumber) {
+	struct v6file *file = malloc(sizeof(struct v6file));
+	if(file == NULL) return NULL;
+	file->fs = fs;
+	file->inumber = inumber;
+	file->sectors = NULL;
+	if(inode_iget(fs, inumber, &file->inode) < 0) {
+		file_close(file);
+		return NULL;
+	}
+	file->size = inode_getsize(&file->inode);
+	file->numBlocks = (file->size + DISKIMG_SECTOR_SIZE - 1) / DISKIMG_SECTOR_SIZE;
+	file->sectors = malloc((file->numBlocks + 1) * sizeof(uint16_t));
+	if(file->sectors == NULL || build_blockmap(file) < 0) {
+		file_close(file);
+		return NULL;
+	}
+	return file;
+}
+
+int file_read(struct v6file *file, int offset, void *buf, int len) {
+	if(offset < 0 || len < 0) return -1;
+	if(offset >= file->size) return 0;
+	if(len > file->size - offset) len = file->size - offset;
+
+	char *dst = buf;
+	int done = 0;
+	while(done < len) {
+		int block = (offset + done) / DISKIMG_SECTOR_SIZE;
+		int within = (offset + done) % DISKIMG_SECTOR_SIZE;
+		int wanted = len - done;
+
+		// find the run of consecutive sectors starting here, as far as it's wanted
+		int needed = (within + wanted - 1) / DISKIMG_SECTOR_SIZE + 1;
+		int run = 1;
+		while(run < needed && run < FILE_MAX_RUN && file->sectors[block + run] == file->sectors[block] + run) run++;
+
+		// read it all at once: whole blocks straight into buf, and the blocks
+		// only partly wanted (at most the first and the last) into buffers of their own
+		char head[DISKIMG_SECTOR_SIZE], tail[DISKIMG_SECTOR_SIZE];
+		void *bufs[run];
+		for(int i = 0; i < run; i++) {
+			int start = i * DISKIMG_SECTOR_SIZE - within;	// where the block goes in dst + done
+			if(start < 0) bufs[i] = head;
+			else if(start + DISKIMG_SECTOR_SIZE > wanted) bufs[i] = tail;
+			else bufs[i] = dst + done + start;
+		}
+		if(diskimg_readsectorsv(file->fs->dfd, file->sectors[block], run, bufs) != run * DISKIMG_SECTOR_SIZE) return -1;
+		int ends[2] = {0, run - 1};
+		for(int j = 0; j < (run == 1 ? 1 : 2); j++) {
+			int i = ends[j];
+			if(bufs[i] != head && bufs[i] != tail) continue;
+			int start = i * DISKIMG_SECTOR_SIZE - within;
+			int from = start < 0 ? -start : 0;
+			int to = start + DISKIMG_SECTOR_SIZE > wanted ? wanted - start : DISKIMG_SECTOR_SIZE;
+			memcpy(dst + done + start + from, (char *) bufs[i] + from, to - from);
+		}
+		int bytes = run * DISKIMG_SECTOR_SIZE - within;
+		done += bytes < wanted ? bytes : wanted;
+	}
+	return done;
+}
+
+void file_close(struct v6file *file) {
+	if(file == NULL) return;
+	free(file->sectors);
+	free(file);
+}
@@ -9,4 +9,38 @@
  */
 int file_getblock(struct unixfilesystem *fs, int inumber, int blockNo, void *buf); 
 
+/**
+ * An open file, for reading a file from start to finish without looking its
+ * inode and indirect blocks up again for every block: the sector holding each
+ * of the file's blocks is worked out once, by file_open().
+ */
+struct v6file {
+  struct unixfilesystem *fs;
+  int inumber;
+  struct inode inode;
+  int size;            // Size of the file in bytes.
+  int numBlocks;       // Number of blocks in the file.
+  uint16_t *sectors;   // The sector holding each block.
+};
+
+/**
+ * Opens the file with the specified inumber for reading, reading each of its
+ * indirect blocks once.  Returns NULL on error.
+ */
+struct v6file *file_open(struct unixfilesystem *fs, int inumber);
+
+/**
+ * Reads up to len bytes of the file, starting offset bytes in, into buf.
+ * Blocks stored in consecutive sectors are read together, with a single
+ * diskimg_readsectorsv() that puts whole blocks straight into buf.  Returns
+ * the number of bytes read, which is less than len only at the end of the
+ * file, or -1 on error.
+ */
+int file_read(struct v6file *file, int offset, void *buf, int len);
+
+/**
+ * Frees a file opened with file_open().
+ */
+void file_close(struct v6file *file);
+
 #endif // _FILE_H_
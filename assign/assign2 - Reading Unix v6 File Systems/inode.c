@@ -11,17 +11,23 @@
  * Returns 0 on success, -1 on error.  
  */
 int inode_iget(struct unixfilesystem *fs, int inumber, struct inode *inp) {
+	// use the inode list loaded at init, if there is one
+	if(fs->inodes != NULL) {
+		if(inumber < 1 || inumber > fs->numInodes) return -1;
+		*inp = fs->inodes[inumber - 1];
+		return 0;
+	}
+
 	// get offset of sector and inumber
 	inumber = inumber - 1;		// inumber starts from 1
 	int inode_num = DISKIMG_SECTOR_SIZE / sizeof(struct inode);
 	int sector_offset = inumber / inode_num;
 	int inumber_offset = inumber % inode_num;
 
-	// get contents of a sector
-	int fd = fs->dfd;
-	struct inode inodes[inode_num];
-	int err = diskimg_readsector(fd, INODE_START_SECTOR + sector_offset, inodes);
-	if(err < 0) return -1;
+	// get contents of a sector, in place if the image is mapped
+	struct inode buf[inode_num];
+	const struct inode *inodes = unixfilesystem_getsector(fs, INODE_START_SECTOR + sector_offset, buf);
+	if(inodes == NULL) return -1;
 	
 	// get contents of an inode
 	*inp = inodes[inumber_offset];
@@ -38,41 +44,65 @@ int inode_iget(struct unixfilesystem *fs, int inumber, struct inode *inp) {
  * Returns the disk block number on success, -1 on error.  
  */
 int inode_indexlookup(struct unixfilesystem *fs, struct inode *inp, int blockNum) {
-	int fd = fs->dfd;
-	int is_small_file = ((inp->i_mode & ILARG) == 0);
+	return inode_indexextent(fs, inp, blockNum, 1, NULL);
+}
 
-	// if it is a small file
-	if(is_small_file) {
-		return inp->i_addr[blockNum];
-	}	
 
-	// if it is a large file
+/**
+ * Like inode_indexlookup, but also counts how many of the blocks from blockNum
+ * on (at most maxBlocks) are stored in consecutive sectors.  The count stops at
+ * the end of the block holding the addresses.
+ *
+ * Returns the disk block number on success, -1 on error.  
+ */
+int inode_indexextent(struct unixfilesystem *fs, struct inode *inp, int blockNum, int maxBlocks, int *extentLen) {
+	int is_small_file = ((inp->i_mode & ILARG) == 0);
 	int addr_num = DISKIMG_SECTOR_SIZE / sizeof(uint16_t);
-	int indir_addr_num = addr_num * INDIR_ADDR;
-	if(blockNum < indir_addr_num) {		// if it only uses INDIR_ADDR
-		int sector_offset = blockNum / addr_num;
-		int addr_offset = blockNum % addr_num;
-		uint16_t addrs[addr_num];
-		int err = diskimg_readsector(fd, inp->i_addr[sector_offset], addrs);
-		if(err < 0) return -1;	
-		return addrs[addr_offset];
-	} else {							// if it also uses the DOUBLE_INDIR_ADDR
-		// the first layer
-		int blockNum_in_double = blockNum - indir_addr_num;
-		int sector_offset_1 = INDIR_ADDR;
-		int addr_offset_1 = blockNum_in_double / addr_num;
-		uint16_t addrs_1[addr_num];
-		int err_1 = diskimg_readsector(fd, inp->i_addr[sector_offset_1], addrs_1);
-		if(err_1 < 0) return -1;
+	const uint16_t *addrs;		// the addresses blockNum's is among
+	int addr_offset;
+	int addr_count;
+	uint16_t buf[addr_num];
+	if(blockNum < 0) return -1;
+
+	if(is_small_file) {				// if it is a small file
+		if(blockNum > INDIR_ADDR) return -1;	// only the INDIR_ADDR + 1 direct addresses
+		addrs = inp->i_addr;
+		addr_offset = blockNum;
+		addr_count = INDIR_ADDR + 1;
+	} else {
+		int indir_addr_num = addr_num * INDIR_ADDR;
+		addr_count = addr_num;
+		if(blockNum < indir_addr_num) {		// if it only uses INDIR_ADDR
+			int sector_offset = blockNum / addr_num;
+			addr_offset = blockNum % addr_num;
+			addrs = unixfilesystem_getsector(fs, inp->i_addr[sector_offset], buf);
+			if(addrs == NULL) return -1;	
+		} else {							// if it also uses the DOUBLE_INDIR_ADDR
+			// the first layer
+			int blockNum_in_double = blockNum - indir_addr_num;
+			int sector_offset_1 = INDIR_ADDR;
+			int addr_offset_1 = blockNum_in_double / addr_num;
+			if(addr_offset_1 >= addr_num) return -1;	// past the last indirect block
+			uint16_t buf_1[addr_num];
+			const uint16_t *addrs_1 = unixfilesystem_getsector(fs, inp->i_addr[sector_offset_1], buf_1);
+			if(addrs_1 == NULL) return -1;
+
+			// the second layer
+			int sector_2 = addrs_1[addr_offset_1];
+			addr_offset = blockNum_in_double % addr_num;
+			addrs = unixfilesystem_getsector(fs, sector_2, buf);
+			if(addrs == NULL) return -1;
+		}
+	}
 
-		// the second layer
-		int sector_2 = addrs_1[addr_offset_1];
-		int addr_offset_2 = blockNum_in_double % addr_num;
-		uint16_t addrs_2[addr_num];
-		int err_2 = diskimg_readsector(fd, sector_2, addrs_2);
-		if(err_2 < 0) return -1;
-		return addrs_2[addr_offset_2];
-	}	
+	// count the run of consecutive sectors starting here
+	int sector = addrs[addr_offset];
+	if(extentLen != NULL) {
+		int len = 1;
+		while(len < maxBlocks && addr_offset + len < addr_count && addrs[addr_offset + len] == sector + len) len++;
+		*extentLen = len;
+	}
+	return sector;
 }
 
 
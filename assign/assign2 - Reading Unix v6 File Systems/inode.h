@@ -17,6 +17,18 @@ int inode_iget(struct unixfilesystem *fs, int inumber, struct inode *inp);
  */
 int inode_indexlookup(struct unixfilesystem *fs, struct inode *inp, int blockNum);
 
+/**
+ * Like inode_indexlookup(), but also sets *extentLen to the length of the
+ * physically contiguous run of blocks starting at blockNum: the number of
+ * blocks, at most maxBlocks, stored in consecutive sectors from the one
+ * returned on.  The run ends where the direct addresses or an indirect block
+ * of addresses do, so reading the blocks that follow it takes another lookup.
+ *
+ * Returns the disk block number on success, -1 on error.  
+ */
+int inode_indexextent(struct unixfilesystem *fs, struct inode *inp, int blockNum,
+                      int maxBlocks, int *extentLen);
+
 /**
  * Computes the size in bytes of the file identified by the given inode
  */
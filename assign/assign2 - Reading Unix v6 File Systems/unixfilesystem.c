@@ -2,6 +2,34 @@
 #include <stdlib.h>
 #include "unixfilesystem.h"
 #include "diskimg.h" 
+#include "bufcache.h"
+#include "dircache.h"
+
+void unixfilesystem_defaultoptions(struct unixfilesystem_options *opts) {
+  opts->cacheSectors = UNIXFILESYSTEM_CACHE_SECTORS;
+  opts->loadInodes = 1;
+  opts->indexNames = 1;
+}
+
+/**
+ * Reads the s_isize sectors of the inode list into one array, all at once, so that
+ * inode_iget() never has to go to the disk.  If any sector can't be read,
+ * the array is dropped and inodes are read as needed, as though it had
+ * never been asked for.
+ */
+static void loadinodes(struct unixfilesystem *fs) {
+  int inodesPerSector = DISKIMG_SECTOR_SIZE / sizeof(struct inode);
+  int numSectors = fs->superblock.s_isize;
+  if (numSectors == 0) return;
+  struct inode *inodes = malloc((size_t) numSectors * DISKIMG_SECTOR_SIZE);
+  if (inodes == NULL) return;
+  if (diskimg_readsectors(fs->dfd, INODE_START_SECTOR, numSectors, inodes) != numSectors * DISKIMG_SECTOR_SIZE) {
+    free(inodes);
+    return;
+  }
+  fs->inodes = inodes;
+  fs->numInodes = numSectors * inodesPerSector;
+}
 
 /**
  * Allocates and initializes a struct unixfilesystem given a filedescriptor to 
@@ -10,6 +38,17 @@
  */
 
 struct unixfilesystem *unixfilesystem_init(int dfd) {
+  struct unixfilesystem_options opts;
+  unixfilesystem_defaultoptions(&opts);
+  return unixfilesystem_initopts(dfd, &opts);
+}
+
+/**
+ * Allocates and initializes a struct unixfilesystem with the specified
+ * settings.  Returns NULL on error.
+ */
+
+struct unixfilesystem *unixfilesystem_initopts(int dfd, const struct unixfilesystem_options *opts) {
   // Validate the bootblock.  This will catch the situation where something 
   // other than a descriptor to a valid diskimg is passed in.
   uint16_t bootblock[256];
@@ -35,11 +74,50 @@ struct unixfilesystem *unixfilesystem_init(int dfd) {
   }
 
   fs->dfd = dfd;  
+  fs->cache = NULL;
+  fs->inodes = NULL;
+  fs->numInodes = 0;
+  fs->names = NULL;
   if (diskimg_readsector(dfd, SUPERBLOCK_SECTOR, &fs->superblock) != DISKIMG_SECTOR_SIZE) {
     fprintf(stderr, "Error reading superblock\n");
     free(fs);
     return NULL;
   }
 
+  if (opts->cacheSectors > 0) {
+    fs->cache = bufcache_create(dfd, opts->cacheSectors);
+    if (fs->cache == NULL) {
+      fprintf(stderr,"Out of memory.\n");
+      unixfilesystem_free(fs);
+      return NULL;
+    }
+  }
+  if (opts->loadInodes) loadinodes(fs);
+  if (opts->indexNames) {
+    fs->names = dircache_create(fs->superblock.s_isize * 16);
+    if (fs->names == NULL) {
+      fprintf(stderr,"Out of memory.\n");
+      unixfilesystem_free(fs);
+      return NULL;
+    }
+  }
+
   return fs;
 }
+
+void unixfilesystem_free(struct unixfilesystem *fs) {
+  if (fs == NULL) return;
+  bufcache_free(fs->cache);
+  free(fs->inodes);
+  dircache_free(fs->names);
+  free(fs);
+}
+
+const void *unixfilesystem_getsector(struct unixfilesystem *fs, int sectorNum, void *buf) {
+  const void *sector = diskimg_sectorptr(fs->dfd, sectorNum);
+  if (sector != NULL) return sector;
+  int bytesRead = fs->cache != NULL ? bufcache_readsector(fs->cache, sectorNum, buf)
+                                     : diskimg_readsector(fs->dfd, sectorNum, buf);
+  if (bytesRead < 0) return NULL;
+  return buf;
+}
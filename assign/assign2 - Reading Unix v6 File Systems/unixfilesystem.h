@@ -9,6 +9,9 @@
 #include "ino.h"        // Inode definition
 #include "direntv6.h"   // Directory entry
 
+struct bufcache;
+struct dircache;
+
 /**
  * The layout of the Unix disk looked as follows:
  * ----------------------------------------------
@@ -25,11 +28,52 @@
 #define ROOT_INUMBER        1
 #define BOOTBLOCK_MAGIC_NUM 0407
 
+// Sectors in the buffer cache of a filesystem initialized with the defaults.
+#define UNIXFILESYSTEM_CACHE_SECTORS 256
+
 struct unixfilesystem {
   int dfd; // Handle from the diskimg module to read the diskimg.
   struct filsys superblock;  // The superblock read from the diskimage.
+  struct bufcache *cache;    // Recently read sectors, or NULL for none.
+  struct inode *inodes;      // The whole inode list, or NULL if it's read as needed.
+  int numInodes;             // Number of inodes in the list (s_isize * 16).
+  struct dircache *names;    // Index of directory entries, or NULL to scan.
 };
 
+/**
+ * Settings for unixfilesystem_initopts().
+ */
+struct unixfilesystem_options {
+  int cacheSectors;  // Size of the buffer cache in sectors, or 0 for no cache.
+  int loadInodes;    // Nonzero to read the whole inode list into memory at init.
+  int indexNames;    // Nonzero to index each directory the first time it's searched.
+};
+
+/**
+ * Fills in the settings unixfilesystem_init() uses.
+ */
+void unixfilesystem_defaultoptions(struct unixfilesystem_options *opts);
+
 struct unixfilesystem *unixfilesystem_init(int fd);
 
+/**
+ * Like unixfilesystem_init(), but with the specified settings.
+ */
+struct unixfilesystem *unixfilesystem_initopts(int fd, const struct unixfilesystem_options *opts);
+
+/**
+ * Frees a struct unixfilesystem and everything it caches.  The disk image
+ * isn't closed.
+ */
+void unixfilesystem_free(struct unixfilesystem *fs);
+
+/**
+ * Returns a pointer to the contents of the specified sector.  When the disk
+ * image is memory-mapped, that's a pointer straight into the mapping and
+ * nothing is copied; otherwise the sector is read into buf (which must hold
+ * DISKIMG_SECTOR_SIZE bytes), through the buffer cache if there is one, and
+ * buf is returned.  Returns NULL on error.
+ */
+const void *unixfilesystem_getsector(struct unixfilesystem *fs, int sectorNum, void *buf);
+
 #endif // _UNIXFILESYSTEM_H_